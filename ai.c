@@ -0,0 +1,494 @@
+/*
+ * ai.c
+ *
+ * Alpha-beta (negamax) search for the computer opponent. Instead of
+ * recursing, each ply of the search is a SearchFrame on an explicit stack
+ * and the search remembers where it got up to between calls to
+ * ai_search_step(). See ai.h for how this is used.
+ *
+ * The strongest level uses Multi-ProbCut to search deeper in the same
+ * number of nodes. Before the moves of a node with enough depth left are
+ * searched, a much shallower search of the same position is used to
+ * predict the deep search's value. If the prediction is far enough above
+ * beta (or below alpha) that the deep search would almost certainly be cut
+ * off, the node is cut off straight away. The shallow searches only test
+ * whether the value is above or below a bound, so they are cheap. How deep
+ * values follow shallow ones was fitted by host/probcut_bench.c, for each
+ * depth and stage of the game, and is kept in probcut_checks[].
+ */
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "ai.h"
+#include "bitboard.h"
+#include "moveorder.h"
+#include "stability.h"
+#include "timer0.h"
+#include "profile.h"
+
+#define SCORE_INFINITY 32000
+// final results are scored by disc difference, scaled so that any win
+// beats any positional score
+#define SCORE_WIN_SCALE 256
+
+// parts of the evaluation, see evaluate()
+#define EVAL_SQUARES	0x01	// square weights, otherwise the disc count
+#define EVAL_MOBILITY	0x02	// how many legal moves each side has
+#define EVAL_FRONTIER	0x04	// how many discs each side has next to empty squares
+#define MOBILITY_WEIGHT	8
+#define FRONTIER_WEIGHT	4
+
+// what a frame will do the next time it is on top of the stack
+#define FRAME_ENTER		0	// first visit, generate moves or evaluate
+#define FRAME_PASS		1	// no legal moves, search the opponent's reply
+#define FRAME_NEXT_MOVE	2	// search the next untried move (if any)
+#define FRAME_PROBE		3	// start the next ProbCut search, if any are left
+#define FRAME_PROBE_HIGH 4	// waiting for a ProbCut search against beta
+#define FRAME_PROBE_LOW	5	// waiting for a ProbCut search against alpha
+
+typedef struct {
+	BitBoard own;		// discs belonging to the side to move at this node
+	BitBoard opp;
+	BitBoard moves;		// legal moves which have not been searched yet
+	int16_t alpha;
+	int16_t beta;
+	int16_t best;
+	uint8_t best_move;
+	uint8_t move;		// move being searched by the frame above this one
+	uint8_t state;
+	uint8_t depth;		// plies left to search below this node
+	uint8_t probe;		// ProbCut searches started, two for each check
+	int16_t bound;		// which the ProbCut search in progress is testing
+} SearchFrame;
+
+typedef struct {
+	uint8_t depth;		// deepest search
+	uint8_t eval;		// EVAL_ flags
+	uint16_t nodes;		// no search is started after this many nodes
+	uint8_t probcut;	// 1 to use Multi-ProbCut
+} AiLevel;
+
+// the levels, weakest first. The weakest just takes the most discs
+static const AiLevel levels[AI_NUM_LEVELS] PROGMEM = {
+	{ 1, 0, 100, 0 },
+	{ 2, EVAL_SQUARES, 400, 0 },
+	{ 4, EVAL_SQUARES, 3000, 0 },
+	{ 6, EVAL_SQUARES | EVAL_MOBILITY, 8000, 0 },
+	{ AI_MAX_DEPTH, EVAL_SQUARES | EVAL_MOBILITY | EVAL_FRONTIER, 20000, 1 }
+};
+
+// one ProbCut check. A search 'depth' plies deep is predicted from one
+// 'shallow' plies deep as
+//		deep = shallow * slope / 256 + offset
+// and is taken to be at least beta (at most alpha) if the prediction is
+// 'margin' or more above beta (below alpha)
+typedef struct {
+	uint8_t shallow;	// 0 if there is no check
+	int16_t slope;
+	int16_t offset;
+	int16_t margin;
+} ProbCutCheck;
+
+// by stage of the game (see AI_PROBCUT_STAGE()), then depth from
+// AI_PROBCUT_MIN_DEPTH up, shallowest check first. Fitted for the
+// strongest level's evaluation by host/probcut_bench.c -c. Its margins are
+// 1.5 standard deviations of the fit: on the bench's test positions that
+// searches 0.6 plies deeper than without ProbCut and loses less value
+// (2.1 against 4.4). Margins of 1.0 went 1.0 plies deeper but lost more
+// (4.8), and 2.0 or more gained little
+static const ProbCutCheck probcut_checks[AI_PROBCUT_NUM_STAGES]
+		[AI_MAX_DEPTH - AI_PROBCUT_MIN_DEPTH + 1][AI_PROBCUT_NUM_CHECKS] PROGMEM = {
+	{	// stage 0
+		{ { 0, 0, 0, 0 }, { 1, 267, 0, 18 } },	// depth 3
+		{ { 0, 0, 0, 0 }, { 2, 256, 2, 17 } },	// depth 4
+		{ { 1, 265, 0, 23 }, { 3, 254, -1, 14 } },	// depth 5
+		{ { 2, 260, 3, 20 }, { 4, 259, 1, 11 } },	// depth 6
+		{ { 3, 258, -2, 17 }, { 5, 260, -2, 8 } },	// depth 7
+		{ { 4, 260, 1, 13 }, { 6, 256, 0, 10 } }	// depth 8
+	},
+	{	// stage 1
+		{ { 0, 0, 0, 0 }, { 1, 256, -5, 34 } },	// depth 3
+		{ { 0, 0, 0, 0 }, { 2, 252, 2, 32 } },	// depth 4
+		{ { 1, 249, -6, 45 }, { 3, 250, -1, 26 } },	// depth 5
+		{ { 2, 250, 4, 49 }, { 4, 256, 2, 29 } },	// depth 6
+		{ { 3, 250, -1, 39 }, { 5, 258, 0, 23 } },	// depth 7
+		{ { 4, 264, 3, 36 }, { 6, 264, 1, 19 } }	// depth 8
+	},
+	{	// stage 2
+		{ { 0, 0, 0, 0 }, { 1, 251, -5, 40 } },	// depth 3
+		{ { 0, 0, 0, 0 }, { 2, 258, 4, 46 } },	// depth 4
+		{ { 1, 249, -7, 63 }, { 3, 255, -3, 41 } },	// depth 5
+		{ { 2, 262, 16, 75 }, { 4, 262, 12, 44 } },	// depth 6
+		{ { 3, 263, 8, 74 }, { 5, 266, 10, 52 } },	// depth 7
+		{ { 4, 268, 24, 83 }, { 6, 264, 12, 60 } }	// depth 8
+	}
+};
+
+static SearchFrame stack[AI_MAX_DEPTH + 1];
+static uint8_t stack_top;
+static uint8_t search_depth;		// of the search in progress
+static uint8_t last_depth;			// deepest search to be done
+static uint16_t node_limit;			// or 0 for none
+static uint8_t eval_terms;
+static uint8_t use_probcut;			// in the search in progress
+static uint8_t probcut_allowed = 1;
+static uint8_t level = AI_DEFAULT_LEVEL;
+static uint8_t searching;
+static uint8_t search_id;			// goes up by one with each search
+static uint8_t result_move = AI_NO_MOVE;
+static int16_t result_score;
+static uint8_t result_depth;
+static uint32_t nodes_searched;
+static uint8_t max_step_time;
+
+// positional value of each square (bitboard order), by its distances from
+// the edges (see BITBOARD_TABLE()). Corners are good, the squares next to
+// them give the corner away. On 8x8:
+//	100, -20,  10,   5,   5,  10, -20, 100,
+//	-20, -50,  -2,  -2,  -2,  -2, -50, -20,
+//	 10,  -2,   1,   1,   1,   1,  -2,  10,
+//	  5,  -2,   1,   0,   0,   1,  -2,   5, ...
+#define WEIGHT(a, b) ((a) <= (b) ? WEIGHT_SORTED(a, b) : WEIGHT_SORTED(b, a))
+#define WEIGHT_SORTED(a, b) ((a) == 0 ? ((b) == 0 ? 100 : (b) == 1 ? -20 : (b) == 2 ? 10 : 5) \
+		: (a) == 1 ? ((b) == 1 ? -50 : -2) : (a) == 2 ? 1 : 0)
+static const int8_t square_weights[64] PROGMEM = BITBOARD_TABLE(WEIGHT);
+
+static int16_t square_score(BitBoard own, BitBoard opp) {
+	int16_t score = 0;
+	const int8_t* weight = square_weights;
+	for (uint8_t row = 0; row < 8; row++) {
+		uint8_t own_row = (uint8_t)own;
+		uint8_t opp_row = (uint8_t)opp;
+		for (uint8_t bit = 0x01; bit != 0; bit <<= 1) {
+			if (own_row & bit) {
+				score += (int8_t)pgm_read_byte(weight);
+			} else if (opp_row & bit) {
+				score -= (int8_t)pgm_read_byte(weight);
+			}
+			weight++;
+		}
+		own >>= 8;
+		opp >>= 8;
+	}
+	return score;
+}
+
+static int16_t evaluate(BitBoard own, BitBoard opp) {
+	int16_t score;
+	if (eval_terms & EVAL_SQUARES) {
+		score = square_score(own, opp);
+	} else {
+		score = (int16_t)bitboard_count(own) - (int16_t)bitboard_count(opp);
+	}
+	if (eval_terms & EVAL_MOBILITY) {
+		score += MOBILITY_WEIGHT *
+				((int16_t)bitboard_count(bitboard_legal_moves(own, opp)) -
+				(int16_t)bitboard_count(bitboard_legal_moves(opp, own)));
+	}
+#if BOARD_FITS_BITBOARD
+	if (eval_terms & EVAL_FRONTIER) {
+		score -= FRONTIER_WEIGHT *
+				((int16_t)bitboard_count(stability_find_frontier(own, opp)) -
+				(int16_t)bitboard_count(stability_find_frontier(opp, own)));
+	}
+#endif
+	return score;
+}
+
+static int16_t final_score(BitBoard own, BitBoard opp) {
+	return ((int16_t)bitboard_count(own) - (int16_t)bitboard_count(opp))
+			* SCORE_WIN_SCALE;
+}
+
+// (re)start the search from the root
+static void start_iteration(void) {
+	stack_top = 0;
+	stack[0].alpha = -SCORE_INFINITY;
+	stack[0].beta = SCORE_INFINITY;
+	stack[0].state = FRAME_ENTER;
+	stack[0].depth = search_depth;
+}
+
+// put a new frame on the stack for the position after a move (or, for
+// ProbCut, the same position)
+static void push_frame(BitBoard own, BitBoard opp, int16_t alpha, int16_t beta,
+		uint8_t depth) {
+	SearchFrame* frame = &stack[++stack_top];
+	frame->own = own;
+	frame->opp = opp;
+	frame->alpha = alpha;
+	frame->beta = beta;
+	frame->state = FRAME_ENTER;
+	frame->depth = depth;
+}
+
+// a / b rounded down, for b > 0
+static int32_t divide_down(int32_t a, int16_t b) {
+	int32_t quotient = a / b;
+	if (a % b != 0 && a < 0) {
+		quotient--;
+	}
+	return quotient;
+}
+
+// starts the next of the frame's ProbCut searches. Returns 0 if there are
+// none left to try, when its moves should be searched as usual
+static uint8_t start_probe(SearchFrame* frame) {
+	uint8_t stage = AI_PROBCUT_STAGE(bitboard_count(frame->own | frame->opp));
+	while (frame->probe < 2 * AI_PROBCUT_NUM_CHECKS) {
+		ProbCutCheck check;
+		memcpy_P(&check, &probcut_checks[stage][frame->depth - AI_PROBCUT_MIN_DEPTH]
+				[frame->probe >> 1], sizeof(check));
+		uint8_t against_beta = !(frame->probe & 0x01);
+		frame->probe++;
+		if (check.shallow == 0) {
+			continue;
+		}
+		// the shallow value at (or beyond) which the deep search is
+		// predicted to be cut off
+		int32_t bound;
+		if (against_beta) {
+			bound = -divide_down(-((int32_t)frame->beta + check.margin - check.offset)
+					* 256, check.slope);
+		} else {
+			bound = divide_down(((int32_t)frame->alpha - check.margin - check.offset)
+					* 256, check.slope);
+		}
+		if (bound <= -SCORE_INFINITY || bound >= SCORE_INFINITY) {
+			continue;
+		}
+		// a null window search tells which side of the bound the value is
+		frame->bound = bound;
+		if (against_beta) {
+			frame->state = FRAME_PROBE_HIGH;
+			push_frame(frame->own, frame->opp, bound - 1, bound, check.shallow);
+		} else {
+			frame->state = FRAME_PROBE_LOW;
+			push_frame(frame->own, frame->opp, bound, bound + 1, check.shallow);
+		}
+		return 1;
+	}
+	return 0;
+}
+
+// the frame on top of the stack has finished with the given value, pass it
+// down to its parent. Returns 1 if the whole search has now finished
+static uint8_t pop_frame(int16_t value) {
+	if (stack_top == 0) {
+		result_move = stack[0].best_move;
+		result_score = value;
+		result_depth = search_depth;
+		if (search_depth < last_depth && nodes_searched < node_limit) {
+			// search again a ply deeper, trying the best move so far first
+			moveorder_cutoff(result_move, 0, search_depth);
+			search_depth++;
+			start_iteration();
+			return 0;
+		}
+		searching = 0;
+		return 1;
+	}
+	SearchFrame* parent = &stack[--stack_top];
+	if (parent->state == FRAME_PROBE_HIGH || parent->state == FRAME_PROBE_LOW) {
+		// a ProbCut search of the parent's own position. If it predicts a
+		// cut off the parent finishes with the bound it would be cut at
+		if (parent->state == FRAME_PROBE_HIGH && value >= parent->bound) {
+			parent->best = parent->beta;
+			parent->moves = 0;
+			parent->state = FRAME_NEXT_MOVE;
+		} else if (parent->state == FRAME_PROBE_LOW && value <= parent->bound) {
+			parent->best = parent->alpha;
+			parent->moves = 0;
+			parent->state = FRAME_NEXT_MOVE;
+		} else {
+			parent->state = FRAME_PROBE;
+		}
+		return 0;
+	}
+	value = -value;
+	if (value > parent->best) {
+		parent->best = value;
+		parent->best_move = parent->move;
+	}
+	if (value > parent->alpha) {
+		parent->alpha = value;
+		// the rest of the parent's moves will be cut off, remember the
+		// move which did it (a pass can't be tried first anywhere else)
+		if (value >= parent->beta && parent->move != AI_NO_MOVE) {
+			moveorder_cutoff(parent->move, stack_top, parent->depth);
+		}
+	}
+	return 0;
+}
+
+// searches to each depth from first_depth to last_depth in turn, not
+// starting another once 'nodes' nodes (if not 0) have been visited
+static void start_search(BitBoard own, BitBoard opp, uint8_t first_depth,
+		uint8_t deepest, uint16_t nodes, uint8_t eval, uint8_t probcut) {
+	search_depth = first_depth;
+	last_depth = deepest;
+	node_limit = nodes;
+	eval_terms = eval;
+	use_probcut = probcut && probcut_allowed;
+	result_move = AI_NO_MOVE;
+	result_score = 0;
+	result_depth = 0;
+	nodes_searched = 0;
+	search_id++;
+	moveorder_clear();
+	stack[0].own = own;
+	stack[0].opp = opp;
+	start_iteration();
+	// with no legal move there is nothing to search
+	searching = (bitboard_legal_moves(own, opp) != 0);
+}
+
+void ai_start_search(BitBoard own, BitBoard opp, uint8_t depth) {
+	if (depth > AI_MAX_DEPTH) {
+		depth = AI_MAX_DEPTH;
+	}
+	if (depth == 0) {
+		depth = 1;
+	}
+	start_search(own, opp, depth, depth, 0,
+			pgm_read_byte(&levels[level - 1].eval), 0);
+}
+
+void ai_start_level_search(BitBoard own, BitBoard opp) {
+	const AiLevel* settings = &levels[level - 1];
+	start_search(own, opp, 1, pgm_read_byte(&settings->depth),
+			pgm_read_word(&settings->nodes), pgm_read_byte(&settings->eval),
+			pgm_read_byte(&settings->probcut));
+}
+
+uint8_t ai_set_level(uint8_t new_level) {
+	if (new_level < 1 || new_level > AI_NUM_LEVELS) {
+		return 0;
+	}
+	level = new_level;
+	return 1;
+}
+
+uint8_t ai_get_level(void) {
+	return level;
+}
+
+void ai_allow_probcut(uint8_t allowed) {
+	probcut_allowed = allowed;
+}
+
+uint8_t ai_search_step(uint16_t node_budget) {
+	if (!searching) {
+		return 1;
+	}
+	uint32_t start_time = get_current_time();
+	PROFILE_BEGIN(PROFILE_AI_SEARCH_STEP);
+
+	while (node_budget > 0) {
+		SearchFrame* frame = &stack[stack_top];
+
+		if (frame->state == FRAME_ENTER) {
+			if (node_limit != 0 && nodes_searched >= node_limit &&
+					result_move != AI_NO_MOVE) {
+				// out of nodes, the deepest search finished gives the move
+				searching = 0;
+				break;
+			}
+			node_budget--;
+			nodes_searched++;
+			frame->best = -SCORE_INFINITY;
+			frame->best_move = AI_NO_MOVE;
+			if (frame->depth == 0) {
+				if (pop_frame(evaluate(frame->own, frame->opp))) {
+					break;
+				}
+				continue;
+			}
+			frame->moves = bitboard_legal_moves(frame->own, frame->opp);
+			if (frame->moves != 0) {
+				frame->state = FRAME_NEXT_MOVE;
+				if (use_probcut && stack_top != 0 && frame->depth >= AI_PROBCUT_MIN_DEPTH) {
+					frame->state = FRAME_PROBE;
+					frame->probe = 0;
+				}
+			} else if (bitboard_legal_moves(frame->opp, frame->own) != 0) {
+				frame->state = FRAME_PASS;
+			} else {
+				// neither side can move, the game is over
+				if (pop_frame(final_score(frame->own, frame->opp))) {
+					break;
+				}
+			}
+		} else if (frame->state == FRAME_PASS) {
+			// the pass is the only "move", once the opponent's reply has
+			// been searched this frame is finished
+			frame->state = FRAME_NEXT_MOVE;
+			frame->move = AI_NO_MOVE;
+			push_frame(frame->opp, frame->own, -frame->beta, -frame->alpha,
+					frame->depth - 1);
+		} else if (frame->state == FRAME_PROBE) {
+			if (!start_probe(frame)) {
+				frame->state = FRAME_NEXT_MOVE;
+			}
+		} else if (frame->moves != 0 && frame->alpha < frame->beta) {
+			uint8_t move = moveorder_next(&frame->moves, stack_top);
+			BitBoard flips = bitboard_flips(frame->own, frame->opp, move);
+			frame->move = move;
+			push_frame(frame->opp & ~flips, frame->own | flips | BITBOARD_BIT(move),
+					-frame->beta, -frame->alpha, frame->depth - 1);
+		} else {
+			// every move has been searched (or the rest were cut off)
+			if (pop_frame(frame->best)) {
+				break;
+			}
+		}
+	}
+
+	PROFILE_END(PROFILE_AI_SEARCH_STEP);
+	uint32_t step_time = get_current_time() - start_time;
+	if (step_time > max_step_time) {
+		max_step_time = (step_time > 0xFF) ? 0xFF : (uint8_t)step_time;
+	}
+	return !searching;
+}
+
+uint8_t ai_is_searching(void) {
+	return searching;
+}
+
+uint8_t ai_search_id(void) {
+	return search_id;
+}
+
+void ai_abort(void) {
+	searching = 0;
+	// a level search may have finished shallower searches already, but
+	// their move is for a position the caller has given up on
+	result_move = AI_NO_MOVE;
+}
+
+uint8_t ai_best_move(void) {
+	return result_move;
+}
+
+int16_t ai_best_score(void) {
+	return result_score;
+}
+
+uint32_t ai_nodes_searched(void) {
+	return nodes_searched;
+}
+
+uint8_t ai_depth_reached(void) {
+	return result_depth;
+}
+
+uint8_t ai_max_step_time(void) {
+	return max_step_time;
+}
+
+void ai_reset_step_time(void) {
+	max_step_time = 0;
+}
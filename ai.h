@@ -0,0 +1,110 @@
+/*
+ * ai.h
+ *
+ * Computer opponent. The search is written as a resumable state machine
+ * with its own explicit stack rather than as a recursive function, so that
+ * it can be run a few nodes at a time from the main game loop. This keeps
+ * the cursor flashing, the buttons/joystick responsive and the seven
+ * segment countdown running while the computer is thinking.
+ *
+ * Typical use:
+ *		ai_start_level_search(own, opp);
+ *		... each time through the game loop ...
+ *		if (ai_search_step(AI_NODES_PER_STEP)) {
+ *			move = ai_best_move();
+ *		}
+ */
+
+#ifndef AI_H_
+#define AI_H_
+
+#include <stdint.h>
+#include "bitboard.h"
+
+// deepest search supported, each extra ply costs one SearchFrame of SRAM
+#define AI_MAX_DEPTH 8
+
+// Multi-ProbCut (see ai.c) is tried at nodes with at least
+// AI_PROBCUT_MIN_DEPTH plies left, with AI_PROBCUT_NUM_CHECKS shallow
+// searches for each depth and a separate fit for each of
+// AI_PROBCUT_NUM_STAGES stages of the game, picked by the number of discs
+#define AI_PROBCUT_MIN_DEPTH	3
+#define AI_PROBCUT_NUM_CHECKS	2
+#define AI_PROBCUT_NUM_STAGES	3
+#define AI_PROBCUT_STAGE(discs) \
+		(((discs) - 4) * AI_PROBCUT_NUM_STAGES / (BOARD_WIDTH * BOARD_HEIGHT - 3))
+
+// the computer opponent's levels, 1 (weakest) to AI_NUM_LEVELS. A level
+// sets how deep the search may go, how many nodes it may visit and what
+// the evaluation looks at (see ai.c). Searches are limited by counting
+// nodes, never by time, so a level plays the same move in the same
+// position on the board as in the host builds. The strongest level takes
+// up to about 10 seconds a move on the board
+#define AI_NUM_LEVELS 5
+#define AI_DEFAULT_LEVEL 3
+
+// number of nodes visited each time ai_search_step() is called from the
+// game loop. Small, so that each step is short; the longest step actually
+// taken is shown on the terminal (see ai_max_step_time())
+#define AI_NODES_PER_STEP 4
+
+// returned by ai_best_move() when the side to move has no legal move
+#define AI_NO_MOVE 0xFF
+
+// start a new search for the player owning 'own' to a depth of 'depth'
+// plies (capped at AI_MAX_DEPTH), with the evaluation of the level set
+// but searching every move. Any search in progress is discarded
+void ai_start_search(BitBoard own, BitBoard opp, uint8_t depth);
+
+// start a search as the computer opponent, at the level set. It searches
+// one ply deep, then two, and so on until the level's depth, stopping
+// early when it runs out of nodes. The move found by the deepest search
+// which finished is played
+void ai_start_level_search(BitBoard own, BitBoard opp);
+
+// returns 0 (and changes nothing) if 'level' isn't 1 to AI_NUM_LEVELS
+uint8_t ai_set_level(uint8_t level);
+uint8_t ai_get_level(void);
+
+// 0 stops levels using Multi-ProbCut, e.g. to measure what it gains
+// (see host/probcut_bench.c). It is allowed unless changed
+void ai_allow_probcut(uint8_t allowed);
+
+// advance the search by at most 'node_budget' nodes. Returns 1 once the
+// search is complete (and keeps returning 1 until a new search is started),
+// 0 if more steps are needed
+uint8_t ai_search_step(uint16_t node_budget);
+
+// returns 1 if a search has been started and has not yet completed
+uint8_t ai_is_searching(void);
+
+// abandon the search in progress (if any). ai_best_move() gives
+// AI_NO_MOVE afterwards
+void ai_abort(void);
+
+// changes each time a search is started. The game loop and remote control
+// share the one search, so each keeps the id of the search it started and
+// only steps, aborts or takes the result of the search with that id
+uint8_t ai_search_id(void);
+
+// the best move found by the last completed search, as a bitboard square
+// index, or AI_NO_MOVE
+uint8_t ai_best_move(void);
+
+// the value of the last completed search for the side to move, in the
+// units of the evaluation (a final result is the disc difference times 256)
+int16_t ai_best_score(void);
+
+// nodes visited by the search in progress or the last one
+uint32_t ai_nodes_searched(void);
+
+// how deep the last completed search went (a level search stops deepening
+// when it runs out of nodes)
+uint8_t ai_depth_reached(void);
+
+// longest time (in milliseconds) a single call to ai_search_step() has
+// taken since the last call to ai_reset_step_time()
+uint8_t ai_max_step_time(void);
+void ai_reset_step_time(void);
+
+#endif /* AI_H_ */
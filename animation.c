@@ -0,0 +1,100 @@
+/*
+ * animation.c
+ *
+ * Disc flip animation. See animation.h.
+ *
+ * Only the move being animated is kept: the flipped discs are found
+ * again each frame by stepping out from the placed disc, so this takes no
+ * more memory however many discs were flipped. In frame f the discs f
+ * squares out turn to MATRIX_COLOUR_FLIPPING and those f - 1 squares out
+ * take on the colour of the player who moved.
+ */
+
+#include <stdint.h>
+
+#include "animation.h"
+#include "display.h"
+#include "rules.h"
+#include "timer0.h"
+
+static HistoryMove move;
+static uint8_t running;
+static uint8_t frame_number;
+static uint8_t last_frame;
+static uint32_t next_frame_time;
+
+// draws the square 'distance' out from the placed disc in 'direction'
+static void draw_flip(uint8_t direction, uint8_t distance, uint8_t object) {
+	uint8_t x = HISTORY_MOVE_X(&move);
+	uint8_t y = HISTORY_MOVE_Y(&move);
+	while (distance--) {
+		rules_step(&x, &y, direction);
+	}
+	draw_square_colour(x, y, object);
+}
+
+static void draw_frame(uint8_t f) {
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		uint8_t length = history_get_run(&move, d);
+		if (f <= length) {
+			draw_flip(d, f, FLIPPING);
+		}
+		if (f > 1 && f - 1 <= length) {
+			draw_flip(d, f - 1, move.player);
+		}
+	}
+	display_flush();
+}
+
+void animation_start(const HistoryMove* new_move) {
+	animation_finish();
+	move = *new_move;
+	// the last frame finishes off the discs furthest out
+	last_frame = 0;
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		uint8_t length = history_get_run(&move, d);
+		if (length > last_frame) {
+			last_frame = length;
+		}
+	}
+	last_frame++;
+	frame_number = 1;
+	next_frame_time = get_current_time();
+	running = 1;
+}
+
+void animation_update(void) {
+	if (!running || get_current_time() < next_frame_time) {
+		return;
+	}
+	draw_frame(frame_number);
+	next_frame_time += ANIMATION_FRAME_MS;
+	if (frame_number++ == last_frame) {
+		running = 0;
+	}
+}
+
+void animation_finish(void) {
+	if (!running) {
+		return;
+	}
+	// a disc half way through shows as flipping, so every disc from the
+	// current frame out is drawn in its final colour
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		uint8_t length = history_get_run(&move, d);
+		uint8_t first = (frame_number > 1) ? frame_number - 1 : 1;
+		for (uint8_t distance = first; distance <= length; distance++) {
+			draw_flip(d, distance, move.player);
+		}
+	}
+	display_flush();
+	running = 0;
+}
+
+void animation_stop(void) {
+	running = 0;
+}
+
+uint8_t animation_running(void) {
+	return running;
+}
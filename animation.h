@@ -0,0 +1,45 @@
+/*
+ * animation.h
+ *
+ * Animates the discs flipped by a move. Instead of every flipped disc
+ * changing colour at once, the flips ripple outwards from the disc which
+ * was placed: each disc fades through MATRIX_COLOUR_FLIPPING to its new
+ * colour, one square further out every frame.
+ *
+ * The board itself changes straight away, only the LED matrix (and the
+ * terminal view) lag behind. Frames are drawn from the main loop when
+ * timer 0 says one is due, and each frame is sent to the LED matrix as a
+ * single update, so an animation never holds up anything else.
+ */
+
+#ifndef ANIMATION_H_
+#define ANIMATION_H_
+
+#include <stdint.h>
+
+#include "history.h"
+
+// time between frames, in milliseconds
+#define ANIMATION_FRAME_MS 60
+
+// starts animating the flips made by 'move', which has just been played
+// (the placed disc itself should already be shown). Any animation still
+// running is finished first
+void animation_start(const HistoryMove* move);
+
+// draws the next frame if it is due. Call this regularly from the main
+// loop
+void animation_update(void);
+
+// draws the end of the animation straight away. Call this before
+// changing any of the animated squares some other way
+void animation_finish(void);
+
+// stops the animation without drawing any more of it, e.g. when the
+// display is about to be cleared
+void animation_stop(void);
+
+// returns 1 while an animation is running
+uint8_t animation_running(void);
+
+#endif /* ANIMATION_H_ */
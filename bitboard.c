@@ -0,0 +1,96 @@
+/*
+ * bitboard.c
+ *
+ * Move generation on bitboards. See bitboard.h for the square layout.
+ */
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "board.h"
+
+// masks used to stop shifted discs wrapping from one row onto the next
+#define NOT_FILE_A 0xFEFEFEFEFEFEFEFEULL	// every square except x = 0
+#define NOT_FILE_H 0x7F7F7F7F7F7F7F7FULL	// every square except x = 7
+
+BitBoard bitboard_shift(BitBoard b, uint8_t direction) {
+	switch(direction) {
+		case 0: return (b << 1) & NOT_FILE_A;	// +x
+		case 1: return (b << 9) & NOT_FILE_A;	// +x +y
+		case 2: return b << 8;					// +y
+		case 3: return (b << 7) & NOT_FILE_H;	// -x +y
+		case 4: return (b >> 1) & NOT_FILE_H;	// -x
+		case 5: return (b >> 9) & NOT_FILE_H;	// -x -y
+		case 6: return b >> 8;					// -y
+		default: return (b >> 7) & NOT_FILE_A;	// +x -y
+	}
+}
+
+BitBoard bitboard_legal_moves(BitBoard own, BitBoard opp) {
+	BitBoard empty = ~(own | opp) & BITBOARD_ON_BOARD;
+	BitBoard moves = 0;
+	for (uint8_t d = 0; d < BITBOARD_NUM_DIRECTIONS; d++) {
+		// grow a run of opponent discs out from each of our discs, a run
+		// can be at most 6 long on an 8x8 board
+		BitBoard run = bitboard_shift(own, d) & opp;
+		for (uint8_t i = 0; i < 5; i++) {
+			run |= bitboard_shift(run, d) & opp;
+		}
+		// an empty square at the end of a run is a legal move
+		moves |= bitboard_shift(run, d) & empty;
+	}
+	return moves;
+}
+
+BitBoard bitboard_flips(BitBoard own, BitBoard opp, uint8_t square) {
+	BitBoard start = BITBOARD_BIT(square);
+	BitBoard flips = 0;
+	if ((own | opp) & start) {
+		return 0;
+	}
+	for (uint8_t d = 0; d < BITBOARD_NUM_DIRECTIONS; d++) {
+		BitBoard run = 0;
+		BitBoard next = bitboard_shift(start, d);
+		while (next & opp) {
+			run |= next;
+			next = bitboard_shift(next, d);
+		}
+		// the run only flips if it is closed off by one of our discs
+		if (next & own) {
+			flips |= run;
+		}
+	}
+	return flips;
+}
+
+// number of bits set in each value from 0 to 15
+static const uint8_t nibble_count[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+uint8_t bitboard_count(BitBoard b) {
+	uint8_t count = 0;
+	// work a byte at a time, 64 bit shifts by a variable amount are slow
+	// on the AVR
+	for (uint8_t i = 0; i < 8; i++) {
+		uint8_t row = (uint8_t)b;
+		count += nibble_count[row & 0x0F] + nibble_count[row >> 4];
+		b >>= 8;
+	}
+	return count;
+}
+
+uint8_t bitboard_pop_lowest(BitBoard* b) {
+	uint8_t square = 0;
+	BitBoard rest = *b;
+	// find the lowest row with a square set, then the lowest square in it
+	while ((uint8_t)rest == 0) {
+		rest >>= 8;
+		square += 8;
+	}
+	uint8_t row = (uint8_t)rest;
+	while ((row & 0x01) == 0) {
+		row >>= 1;
+		square++;
+	}
+	*b &= *b - 1;	// clears the lowest set bit
+	return square;
+}
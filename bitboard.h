@@ -0,0 +1,85 @@
+/*
+ * bitboard.h
+ *
+ * A bitboard stores one bit per square of the 8x8 board. Square (x, y)
+ * is bit number (y * 8 + x), so each byte of the bitboard holds one row
+ * of the board with x = 0 in the least significant bit. Smaller boards
+ * (see board.h) keep the same layout and leave the extra squares empty.
+ *
+ * Whole-board operations (finding every legal move, finding every disc
+ * flipped by a move) are done with shifts and masks rather than by
+ * walking each square, which is what makes it practical to search ahead.
+ */
+
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+typedef uint64_t BitBoard;
+
+// square index for (x, y) and the bitboard with only that square set
+#define BITBOARD_SQUARE(x, y)	((uint8_t)(((y) << 3) | (x)))
+#define BITBOARD_SQUARE_X(sq)	((sq) & 0x07)
+#define BITBOARD_SQUARE_Y(sq)	((sq) >> 3)
+#define BITBOARD_BIT(sq)		((BitBoard)1 << (sq))
+
+// squares which are on the board. A board smaller than 8x8 uses the bottom
+// left corner of the bitboard; no disc is ever put on the other squares, so
+// runs of discs stop at the board's edge without any extra masks
+#if BOARD_FITS_BITBOARD
+#define BITBOARD_ON_BOARD ((((1ULL << BOARD_WIDTH) - 1) * 0x0101010101010101ULL) \
+		& (~0ULL >> (64 - 8 * BOARD_HEIGHT)))
+#else
+#define BITBOARD_ON_BOARD (~0ULL)
+#endif
+
+// directions for bitboard_shift(): +x, +x +y, +y, -x +y, -x, -x -y, -y,
+// +x -y. Direction d + 4 is the opposite of direction d
+#define BITBOARD_NUM_DIRECTIONS 8
+
+// moves every square of b one step in 'direction', dropping anything
+// which falls off the edge of the 8x8 bitboard (but not squares which
+// land outside a smaller board, mask with BITBOARD_ON_BOARD for those)
+BitBoard bitboard_shift(BitBoard b, uint8_t direction);
+
+// returns every square that is a legal move for the player owning 'own'
+// when the opponent owns 'opp'
+BitBoard bitboard_legal_moves(BitBoard own, BitBoard opp);
+
+// returns the opponent discs that would be flipped if the player owning
+// 'own' placed a disc on 'square'. An empty result means the move is illegal
+BitBoard bitboard_flips(BitBoard own, BitBoard opp, uint8_t square);
+
+// returns the number of squares set in the bitboard
+uint8_t bitboard_count(BitBoard b);
+
+// removes the lowest set square from the bitboard and returns its index.
+// The bitboard must not be empty
+uint8_t bitboard_pop_lowest(BitBoard* b);
+
+// Initialiser for a 64 entry table (bitboard order) with a value for each
+// square worked out from how far it is from the edges of the board, so the
+// table suits whatever size the board is. value(a, b) is a macro giving the
+// value of a square a squares from the nearest side and b from the nearest
+// top or bottom, each counted from 0 and at most 3. Squares which aren't on
+// the board get 0
+#define BITBOARD_EDGE_DISTANCE(i, n) \
+		((i) < 3 && (i) < (n) - 1 - (i) ? (i) : (n) - 1 - (i) < 3 ? (n) - 1 - (i) : 3)
+#define BITBOARD_SQUARE_VALUE(value, x, y) \
+		(((x) < BOARD_WIDTH && (y) < BOARD_HEIGHT) ? value(BITBOARD_EDGE_DISTANCE(x, BOARD_WIDTH), \
+				BITBOARD_EDGE_DISTANCE(y, BOARD_HEIGHT)) : 0)
+#define BITBOARD_TABLE_ROW(value, y) \
+		BITBOARD_SQUARE_VALUE(value, 0, y), BITBOARD_SQUARE_VALUE(value, 1, y), \
+		BITBOARD_SQUARE_VALUE(value, 2, y), BITBOARD_SQUARE_VALUE(value, 3, y), \
+		BITBOARD_SQUARE_VALUE(value, 4, y), BITBOARD_SQUARE_VALUE(value, 5, y), \
+		BITBOARD_SQUARE_VALUE(value, 6, y), BITBOARD_SQUARE_VALUE(value, 7, y)
+#define BITBOARD_TABLE(value) { \
+		BITBOARD_TABLE_ROW(value, 0), BITBOARD_TABLE_ROW(value, 1), \
+		BITBOARD_TABLE_ROW(value, 2), BITBOARD_TABLE_ROW(value, 3), \
+		BITBOARD_TABLE_ROW(value, 4), BITBOARD_TABLE_ROW(value, 5), \
+		BITBOARD_TABLE_ROW(value, 6), BITBOARD_TABLE_ROW(value, 7) }
+
+#endif /* BITBOARD_H_ */
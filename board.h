@@ -0,0 +1,36 @@
+/*
+ * board.h
+ *
+ * Board dimensions. The board is 8x8 unless it is changed at compile time,
+ * e.g. with -DBOARD_WIDTH=10 -DBOARD_HEIGHT=10. Both dimensions must be
+ * even (so the four starting discs sit in the centre) and between 4 and 16.
+ *
+ * Boards up to 8x8 are also kept as bitboards (see bitboard.h), which the
+ * computer opponent, move hints and the remote control protocol rely on.
+ * Bigger boards are played with the square-by-square rules in rules.c only,
+ * and are scrolled on the LED matrix if they are taller than it.
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#ifndef BOARD_WIDTH
+#define BOARD_WIDTH 8
+#endif
+#ifndef BOARD_HEIGHT
+#define BOARD_HEIGHT 8
+#endif
+
+#if BOARD_WIDTH < 4 || BOARD_WIDTH > 16 || (BOARD_WIDTH & 1)
+#error "BOARD_WIDTH must be even and between 4 and 16"
+#endif
+#if BOARD_HEIGHT < 4 || BOARD_HEIGHT > 16 || (BOARD_HEIGHT & 1)
+#error "BOARD_HEIGHT must be even and between 4 and 16"
+#endif
+
+#define BOARD_SQUARES (BOARD_WIDTH * BOARD_HEIGHT)
+
+// 1 if the board fits in a bitboard
+#define BOARD_FITS_BITBOARD (BOARD_WIDTH <= 8 && BOARD_HEIGHT <= 8)
+
+#endif /* BOARD_H_ */
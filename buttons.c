@@ -7,6 +7,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "buttons.h"
+#include "trace.h"
 
 // Global variable to keep track of the last button state so that we 
 // can detect changes when an interrupt fires. The lower 3 bits (0 to 2)
@@ -87,6 +88,7 @@ ISR(PCINT1_vect) {
 			// Add the button push to the queue (and update the
 			// length of the queue
 			button_queue[queue_length++] = pin;
+			TRACE_LOG(TRACE_BUTTON, pin);
 		}
 	}
 	
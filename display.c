@@ -10,14 +10,76 @@
 #include "display.h"
 #include "pixel_colour.h"
 #include "ledmatrix.h"
+#include "terminalio.h"
 
-// constant value used to display 'RVRSI' on launch
-static const uint8_t reversi_display[MATRIX_NUM_COLUMNS] = 
-		{125, 81, 89, 117, 120, 4, 120, 125, 81, 89, 117, 116, 84, 84, 92, 93};
+// The 'RVRSI' shown on launch. Each column was designed as a byte: the
+// top 7 bits are the pixels in rows 7 to 1 and the LSB is the colour (1 is
+// red, 0 is green). The macros below expand these into whole columns of
+// pixels when compiling, so the frame is ready to send straight from flash
+#define START_COLOUR(bits) (((bits) & 0x01) ? COLOUR_RED : COLOUR_GREEN)
+#define START_PIXEL(bits, row) (((bits) & (1 << (row))) ? START_COLOUR(bits) : COLOUR_BLACK)
+#define START_COLUMN(bits) { COLOUR_BLACK, START_PIXEL(bits, 1), START_PIXEL(bits, 2), \
+		START_PIXEL(bits, 3), START_PIXEL(bits, 4), START_PIXEL(bits, 5), \
+		START_PIXEL(bits, 6), START_PIXEL(bits, 7) }
+static const MatrixData reversi_display PROGMEM = {
+		START_COLUMN(125), START_COLUMN(81), START_COLUMN(89), START_COLUMN(117),
+		START_COLUMN(120), START_COLUMN(4), START_COLUMN(120), START_COLUMN(125),
+		START_COLUMN(81), START_COLUMN(89), START_COLUMN(117), START_COLUMN(116),
+		START_COLUMN(84), START_COLUMN(84), START_COLUMN(92), START_COLUMN(93)
+};
+
+// a copy of what is currently shown on the LED matrix, so that the whole
+// display can be resent in one go
+static MatrixData frame;
+
+#if BOARD_FITS_BITBOARD
+// squares currently showing a move hint, and the colour they are shown in
+static BitBoard hint_squares;
+static PixelColour hint_colour;
+#endif
+
+// matrix columns and rows (one bit each) with squares changed by
+// draw_square_colour() which haven't been sent yet
+static uint16_t dirty_columns;
+static uint8_t dirty_rows;
+
+// the board row shown on the bottom row of the LED matrix. Only changes
+// if the board is taller than the matrix
+static uint8_t view_y;
+
+// top left of the board view on the terminal
+#define TERMINAL_BOARD_X 60
+#define TERMINAL_BOARD_Y 8
+
+#if BOARD_FITS_BITBOARD
+// terminal cell used for a move hint
+static uint8_t hint_cell(void) {
+	if (hint_colour == MATRIX_COLOUR_HINT_P1) {
+		return TERM_CELL('*', FG_RED);
+	} else {
+		return TERM_CELL('*', FG_GREEN);
+	}
+}
+#endif
+
+// clear our copy of the display to match ledmatrix_clear()
+static void clear_frame(void) {
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		set_matrix_column_to_colour(frame[x], COLOUR_BLACK);
+	}
+}
 
 void initialise_display(void) {
 	// start by clearing the LED matrix
 	ledmatrix_clear();
+	clear_frame();
+#if BOARD_FITS_BITBOARD
+	hint_squares = 0;
+#endif
+	view_y = 0;
+	dirty_columns = 0;
+	dirty_rows = 0;
+	init_terminal_board(TERMINAL_BOARD_X, TERMINAL_BOARD_Y);
 
 	// create an array with the background colour at every position
 	PixelColour col_colours[MATRIX_NUM_ROWS];
@@ -28,61 +90,242 @@ void initialise_display(void) {
 	// then add the bounds on the left
 	for (int x = 0; x < MATRIX_X_OFFSET; x++) {
 		ledmatrix_update_column(x, col_colours);
+		copy_matrix_column(col_colours, frame[x]);
 	}
 
 	// and add the bounds on the right
 	for (int x = MATRIX_X_OFFSET + WIDTH; x < MATRIX_NUM_COLUMNS; x++) {
 		ledmatrix_update_column(x, col_colours);
+		copy_matrix_column(col_colours, frame[x]);
+	}
+
+	// and above the board, if it is shorter than the matrix
+	if (HEIGHT < MATRIX_NUM_ROWS) {
+		for (int row = 0; row < HEIGHT; row++) {
+			col_colours[row] = MATRIX_COLOUR_EMPTY;
+		}
+		for (int x = MATRIX_X_OFFSET; x < MATRIX_X_OFFSET + WIDTH; x++) {
+			ledmatrix_update_column(x, col_colours);
+			copy_matrix_column(col_colours, frame[x]);
+		}
 	}
 }
 
+uint8_t display_scroll_to(uint8_t y) {
+	if (HEIGHT <= MATRIX_NUM_ROWS) {
+		return 0;
+	}
+	uint8_t new_view_y = view_y;
+	if (y < view_y) {
+		new_view_y = y;
+	} else if (y >= view_y + MATRIX_NUM_ROWS) {
+		new_view_y = y - MATRIX_NUM_ROWS + 1;
+	}
+	if (new_view_y == view_y) {
+		return 0;
+	}
+	view_y = new_view_y;
+	return 1;
+}
+
 void start_display(void) {
-	PixelColour colour;
-	MatrixColumn column_colour_data;
-	uint8_t col_data;
-		
 	ledmatrix_clear(); // start by clearing the LED matrix
-	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++) {
-		col_data = reversi_display[col];
-		// using the LSB as the colour determining bit, 1 is red, 0 is green
-		if (col_data & 0x01) {
-			colour = COLOUR_RED;
-		} else {
-			colour = COLOUR_GREEN;
-		}
-		// go through the top 7 bits (not the bottom one as that was our colour bit)
-		// and set any to be the correct colour
-		for(uint8_t i=7; i>=1; i--) {
-			// If the relevant font bit is set, we make this a coloured pixel, else blank
-			if(col_data & 0x80) {
-				column_colour_data[i] = colour;
-				} else {
-				column_colour_data[i] = 0;
-			}
-			col_data <<= 1;
-		}
-		column_colour_data[0] = 0;
-		ledmatrix_update_column(col, column_colour_data);
+#if BOARD_FITS_BITBOARD
+	hint_squares = 0;
+#endif
+	ledmatrix_update_all_P(&reversi_display[0][0]);
+	memcpy_P(frame, reversi_display, sizeof(frame));
+}
+
+// the banner being scrolled by display_marquee_step(), and the column of
+// it (or of the gap after it) which comes on next
+static const PixelColour* marquee_columns;
+static uint8_t marquee_length;
+static uint8_t marquee_gap;
+static uint8_t marquee_next;
+
+void display_marquee_start(const PixelColour* columns, uint8_t length, uint8_t gap) {
+	marquee_columns = columns;
+	marquee_length = length;
+	marquee_gap = gap;
+	// the banner starts off filling the display, so the next column is
+	// the one after the first screenful
+	marquee_next = MATRIX_NUM_COLUMNS % (length + gap);
+}
+
+void display_marquee_step(void) {
+	if (marquee_length == 0) {
+		return;
+	}
+	// move everything one column left, on the LED matrix and in our copy
+	// of it, then only the new column on the right needs sending
+	ledmatrix_shift_display_left();
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS - 1; x++) {
+		copy_matrix_column(frame[x + 1], frame[x]);
+	}
+	PixelColour* column = frame[MATRIX_NUM_COLUMNS - 1];
+	if (marquee_next < marquee_length) {
+		memcpy_P(column, &marquee_columns[marquee_next * MATRIX_NUM_ROWS],
+				sizeof(MatrixColumn));
+	} else {
+		set_matrix_column_to_colour(column, COLOUR_BLACK);
+	}
+	ledmatrix_update_column(MATRIX_NUM_COLUMNS - 1, column);
+	marquee_next++;
+	if (marquee_next == marquee_length + marquee_gap) {
+		marquee_next = 0;
 	}
 }
 
-void update_square_colour(uint8_t x, uint8_t y, uint8_t object) {
+void start_display_marquee(void) {
+	display_marquee_start(&reversi_display[0][0], MATRIX_NUM_COLUMNS, START_MARQUEE_GAP);
+}
+
+// works out the colour for 'object' on square (x, y), shows it on the
+// terminal view and records it in our copy of the display. Returns 0 if
+// the square is scrolled off the LED matrix, otherwise 1 with the matrix
+// position of the square in (*x, *y)
+static uint8_t set_square_colour(uint8_t* x, uint8_t* y, uint8_t object) {
 	// determine which colour corresponds to this object
+	// (and what the board view on the terminal should show)
 	PixelColour colour;
+	uint8_t cell;
 	if (object == PLAYER_1) {
 		colour = MATRIX_COLOUR_P1;
+		cell = TERM_CELL('#', FG_RED);
 		} else if (object == PLAYER_2) {
 		colour = MATRIX_COLOUR_P2;
+		cell = TERM_CELL('#', FG_GREEN);
 		} else if (object == CURSOR) {
 		colour = MATRIX_COLOUR_CURSOR;
+		cell = TERM_CELL('+', FG_YELLOW);
 		} else if (object == INVALID_CURSOR) {
 		colour = MATRIX_COLOUR_INVALID_CURSOR;	
+		cell = TERM_CELL('?', FG_YELLOW);
+		} else if (object == FLIPPING) {
+		colour = MATRIX_COLOUR_FLIPPING;
+		cell = TERM_CELL('%', FG_YELLOW);
+#if BOARD_FITS_BITBOARD
+		} else if (hint_squares & BITBOARD_BIT(BITBOARD_SQUARE(*x, *y))) {
+		// an empty square with a move hint on it
+		colour = hint_colour;
+		cell = hint_cell();
+#endif
 		} else {
 		// anything unexpected will be black
 		colour = MATRIX_COLOUR_EMPTY;
+		cell = TERM_CELL('.', FG_WHITE);
 	}
+	set_terminal_board_cell(*x, *y, cell);
 
-	// update the pixel at the given location with this colour
 	// the board is offset on the x axis to be centred on the LED matrix
-	ledmatrix_update_pixel(x + MATRIX_X_OFFSET, y, colour);
-}
\ No newline at end of file
+	// (and squares scrolled off the top or bottom aren't shown)
+	if (*y < view_y || *y >= view_y + MATRIX_NUM_ROWS) {
+		return 0;
+	}
+	*x += MATRIX_X_OFFSET;
+	*y -= view_y;
+	frame[*x][*y] = colour;
+	return 1;
+}
+
+void update_square_colour(uint8_t x, uint8_t y, uint8_t object) {
+	// update the pixel at the given location with this colour
+	if (set_square_colour(&x, &y, object)) {
+		ledmatrix_update_pixel(x, y, frame[x][y]);
+	}
+}
+
+void draw_square_colour(uint8_t x, uint8_t y, uint8_t object) {
+	if (set_square_colour(&x, &y, object)) {
+		dirty_columns |= ((uint16_t)1 << x);
+		dirty_rows |= (1 << y);
+	}
+}
+
+void display_flush(void) {
+	if (dirty_rows == 0) {
+		return;
+	}
+	// (a mask with just one bit set has no bits left once its lowest is
+	// cleared)
+	uint8_t one_row = (dirty_rows & (dirty_rows - 1)) == 0;
+	uint8_t one_column = (dirty_columns & (dirty_columns - 1)) == 0;
+	uint8_t x = 0;
+	uint8_t y = 0;
+	while (!(dirty_columns & ((uint16_t)1 << x))) {
+		x++;
+	}
+	while (!(dirty_rows & (1 << y))) {
+		y++;
+	}
+	if (one_row && one_column) {
+		ledmatrix_update_pixel(x, y, frame[x][y]);
+	} else if (one_column) {
+		ledmatrix_update_column(x, frame[x]);
+	} else if (one_row) {
+		MatrixRow row;
+		for (x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			row[x] = frame[x][y];
+		}
+		ledmatrix_update_row(y, row);
+	} else {
+		ledmatrix_update_all(frame);
+	}
+	dirty_columns = 0;
+	dirty_rows = 0;
+}
+
+#if BOARD_FITS_BITBOARD
+
+void show_hint_squares(BitBoard hints, uint8_t player) {
+	PixelColour new_colour;
+	if (player == PLAYER_1) {
+		new_colour = MATRIX_COLOUR_HINT_P1;
+	} else {
+		new_colour = MATRIX_COLOUR_HINT_P2;
+	}
+	if (hints == hint_squares && new_colour == hint_colour) {
+		// nothing has changed, don't resend the display
+		return;
+	}
+
+	// change our copy of the display, leaving alone any square which is
+	// showing something other than empty or an old hint (e.g. the cursor)
+	for (uint8_t y = 0; y < HEIGHT; y++) {
+		for (uint8_t x = 0; x < WIDTH; x++) {
+			BitBoard square = BITBOARD_BIT(BITBOARD_SQUARE(x, y));
+			PixelColour* pixel = &frame[x + MATRIX_X_OFFSET][y];
+			uint8_t showing_hint = (hint_squares & square) && *pixel == hint_colour;
+			if (*pixel != MATRIX_COLOUR_EMPTY && !showing_hint) {
+				continue;
+			}
+			if (hints & square) {
+				*pixel = new_colour;
+			} else {
+				*pixel = MATRIX_COLOUR_EMPTY;
+			}
+		}
+	}
+	hint_squares = hints;
+	hint_colour = new_colour;
+
+	// the terminal view shows the same hints
+	for (uint8_t y = 0; y < HEIGHT; y++) {
+		for (uint8_t x = 0; x < WIDTH; x++) {
+			PixelColour pixel = frame[x + MATRIX_X_OFFSET][y];
+			if (pixel == hint_colour && (hints & BITBOARD_BIT(BITBOARD_SQUARE(x, y)))) {
+				set_terminal_board_cell(x, y, hint_cell());
+			} else if (pixel == MATRIX_COLOUR_EMPTY) {
+				set_terminal_board_cell(x, y, TERM_CELL('.', FG_WHITE));
+			}
+		}
+	}
+
+	// and send the whole lot with one command (which takes care of any
+	// squares waiting for display_flush() too)
+	ledmatrix_update_all(frame);
+	dirty_columns = 0;
+	dirty_rows = 0;
+}
+#endif /* BOARD_FITS_BITBOARD */
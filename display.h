@@ -8,12 +8,14 @@
 #define DISPLAY_H_
 
 #include "pixel_colour.h"
+#include "bitboard.h"
+#include "board.h"
 
-// display dimensions, these match the size of the board
-#define WIDTH  8
-#define HEIGHT 8
-// offset for the LED matrix, since our board starts on the edge
-#define MATRIX_X_OFFSET 4
+// display dimensions, these match the size of the board (see board.h)
+#define WIDTH  BOARD_WIDTH
+#define HEIGHT BOARD_HEIGHT
+// offset for the LED matrix (16 columns wide), so that the board is centred
+#define MATRIX_X_OFFSET ((16 - WIDTH) / 2)
 
 // object definitions
 #define EMPTY_SQUARE    0
@@ -21,6 +23,7 @@
 #define PLAYER_2		2
 #define CURSOR			3
 #define INVALID_CURSOR	4
+#define FLIPPING		5	// a disc part way through being flipped
 
 // matrix colour definitions
 #define MATRIX_COLOUR_EMPTY		COLOUR_BLACK
@@ -29,18 +32,58 @@
 #define MATRIX_COLOUR_CURSOR	COLOUR_ORANGE
 #define MATRIX_COLOUR_BG		COLOUR_LIGHT_YELLOW 
 #define MATRIX_COLOUR_INVALID_CURSOR	COLOUR_YELLOW_GREEN
+#define MATRIX_COLOUR_HINT_P1	COLOUR_DIM_RED
+#define MATRIX_COLOUR_HINT_P2	COLOUR_DIM_GREEN
+#define MATRIX_COLOUR_FLIPPING	COLOUR_YELLOW
 
 // initialise the display for the board, this creates the display
 // for an empty board
 void initialise_display(void);
 
-// shows a starting display
+// shows a starting display, sent to the LED matrix with one update
 void start_display(void);
 
+// Scrolls a banner across the LED matrix, one column per call to
+// display_marquee_step(). Each step shifts the display left and sends just
+// the new column on the right. 'columns' is 'length' MatrixColumns in
+// program memory (column 0 first), followed by 'gap' blank columns before
+// it repeats. The banner should already be showing from column 0, e.g.
+// with start_display()
+void display_marquee_start(const PixelColour* columns, uint8_t length, uint8_t gap);
+void display_marquee_step(void);
+
+// scrolls the starting display round as a marquee
+#define START_MARQUEE_GAP 4
+#define START_MARQUEE_FRAME_MS 120
+void start_display_marquee(void);
+
 // updates the colour at square (x, y) to be the colour
 // of the object 'object'
 // 'object' is expected to be EMPTY_SQUARE, PLAYER_1, PLAYER_2 or 
 // CURSOR
 void update_square_colour(uint8_t x, uint8_t y, uint8_t object);
 
+// the same as update_square_colour(), but the LED matrix isn't updated
+// until display_flush() is called. Use this to change several squares
+// with one update
+void draw_square_colour(uint8_t x, uint8_t y, uint8_t object);
+
+// sends every square changed by draw_square_colour() since the last call
+// to the LED matrix, with the smallest single command which covers them
+// all (a pixel, a row, a column or the whole display)
+void display_flush(void);
+
+// scrolls the LED matrix so that board row y is on it, if the board is
+// taller than the matrix. Returns 1 if it scrolled, in which case every
+// square needs to be redrawn with update_square_colour()
+uint8_t display_scroll_to(uint8_t y);
+
+#if BOARD_FITS_BITBOARD
+// shows every square in 'hints' (which should be empty squares) in a dim
+// version of 'player's colour. The whole matrix is redrawn with a single
+// update rather than a pixel command per square. Hint squares stay shown
+// until the next call, pass 0 to remove them
+void show_hint_squares(BitBoard hints, uint8_t player);
+#endif
+
 #endif 
\ No newline at end of file
@@ -13,20 +13,30 @@
 
 #include "game.h"
 #include "display.h"
+#include "bitboard.h"
 #include "terminalio.h"
 #include "timer0.h"
+#include "profile.h"
+#include "trace.h"
+#include "rules.h"
+#include "save.h"
+#include "history.h"
+#include "animation.h"
 
 
 
 // #include "buttons.h"
 // #include "serialio.h"
 
-#define CURSOR_X_START 5
-#define CURSOR_Y_START 3
+#define CURSOR_X_START (WIDTH / 2 + 1)
+#define CURSOR_Y_START (HEIGHT / 2 - 1)
 
+// the starting pieces sit on the four centre squares
 #define START_PIECES 2
-static const uint8_t p1_start_pieces[START_PIECES][2] = { {3, 3}, {4, 4} };
-static const uint8_t p2_start_pieces[START_PIECES][2] = { {3, 4}, {4, 3}}; // 
+static const uint8_t p1_start_pieces[START_PIECES][2] = 
+		{ {WIDTH / 2 - 1, HEIGHT / 2 - 1}, {WIDTH / 2, HEIGHT / 2} };
+static const uint8_t p2_start_pieces[START_PIECES][2] = 
+		{ {WIDTH / 2 - 1, HEIGHT / 2}, {WIDTH / 2, HEIGHT / 2 - 1} };
 
 
 uint8_t board[WIDTH][HEIGHT];
@@ -37,9 +47,24 @@ uint8_t current_player;
 
 uint32_t last_flash_time, current_time;
 
+uint8_t game_over = 0;
+uint8_t game_over_flag = 0;
+
+// set while a saved game is replayed, when nothing is drawn until the end
+static uint8_t replaying = 0;
+
+// update_square_colour(), unless a saved game is being replayed
+static void show_square(uint8_t x, uint8_t y, uint8_t piece) {
+	if (!replaying) {
+		update_square_colour(x, y, piece);
+	}
+}
+
 void initialise_board(void) {
 	
-	// initialise the display we are using
+	// initialise the display we are using (any flips still being
+	// animated are about to be wiped off it)
+	animation_stop();
 	initialise_display();
 	
 	// initialise the board to be all empty
@@ -75,6 +100,14 @@ void initialise_board(void) {
 
 	last_flash_time = get_current_time();
 
+	// a new game has no moves to undo, and isn't over
+	history_clear();
+	game_over = 0;
+	game_over_flag = 0;
+
+	// show move hints for the first player (if they are turned on)
+	update_move_hints();
+
 	// joystick
 	ADMUX = (1<<REFS0);
 	ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS1);
@@ -137,6 +170,7 @@ void movement_control(void) {
 		; /* Wait until conversion finished */
 	}
 	value = ADC; // read the value
+	TRACE_LOG(x_or_y ? TRACE_ADC_Y : TRACE_ADC_X, value >> 2);
 	// up right >850 >850 left down <300 <300 left up <200 >850 right down >700 <300
 	if(x_or_y == 0) {
 		if (value > 800) {
@@ -182,7 +216,7 @@ void movement_control(void) {
 uint8_t get_piece_at(uint8_t x, uint8_t y) {
 	// check the bounds, anything outside the bounds
 	// will be considered empty
-	if (x < 0 || x >= WIDTH || y < 0 || y >= WIDTH) {
+	if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) {
 		return EMPTY_SQUARE;
 	} else {
 		//if in the bounds, just index into the array
@@ -192,155 +226,38 @@ uint8_t get_piece_at(uint8_t x, uint8_t y) {
 
 
 
-//0:do not need to loop,1:need to loop,2:loop to change color
-uint8_t need_to_check[8];
+// directions in which the last position checked by is_valid_position()
+// flips discs, one bit per direction (see rules.h)
+uint8_t flip_directions;
 
 uint8_t is_valid_position(uint8_t px, uint8_t py) {
-	
-	uint8_t cursor_surrounding[8][2] = {
-		{px - 1, py + 1}, {px, py + 1}, {px + 1, py + 1}, 
-		{px + 1, py}, {px + 1, py - 1}, {px, py - 1}, 
-		{px - 1, py - 1}, {px - 1, py}
-	};
-	if (board[px][py] != EMPTY_SQUARE) {
-		return 0;
-	} else {
-		uint8_t opponent;
-		if (current_player == PLAYER_1) {
-			opponent = PLAYER_2;
-		} else {
-			opponent = PLAYER_1;
-		}
-		// init the need to check list
-		for (uint8_t i = 0; i < 8; i++) {
-			need_to_check[i] = 0;
-		}
-		// check whether there is a opponent in the surrounding
-		for (uint8_t i = 0; i < 8; i++) {
-			uint8_t x = cursor_surrounding[i][0];
-			uint8_t y = cursor_surrounding[i][1];
-			uint8_t obj = get_piece_at(x, y);
-			if (obj == opponent) {
-				need_to_check[i] = 1;
-			}
-		}
-		// check whether there is a piece in the current player union in the line
-		uint8_t valid_position_flag = 0;
-		for (uint8_t i = 0; i < 8; i++) {
-			if (need_to_check[i] == 1) {
-				uint8_t x = px;
-				uint8_t y = py;
-				if (i == 0) {
-					do {
-						x -= 1;
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x >= 0 && y <= 7); 
-
-				} else if (i == 1) {
-					do {
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (y <= 7);
-
-				} else if (i == 2) {
-					do {
-						x += 1;
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x <= 7 && y <= 7);
-
-				} else if (i == 3) {
-					do {
-						x += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x <= 7);
-
-				} else if (i == 4) {
-					do {
-						x += 1;
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x <= 7 && y >= 0);
-
-				} else if (i == 5) {
-					do {
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (y >= 0);
-
-				} else if (i == 6) {
-					do {
-						x -= 1;
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x >= 0 && y >= 0);
-
-				} else if (i == 7) {
-					do {
-						x -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == EMPTY_SQUARE) {
-							break;
-						} else if (obj == current_player) {
-							need_to_check[i] = 2;
-							valid_position_flag = 1;
-						} 
-					} while (x >= 0);
+	flip_directions = rules_flip_directions(board, px, py, current_player);
+	return flip_directions != 0;
+}
 
-				}
-			}
-		}
-		return valid_position_flag;
+uint8_t is_legal_move(uint8_t x, uint8_t y) {
+	if (x >= WIDTH || y >= HEIGHT || is_game_over()) {
+		return 0;
 	}
-	return 0;
+	return rules_flip_directions(board, x, y, current_player) != 0;
+}
+
+uint8_t get_current_player(void) {
+	return current_player;
 }
 
+#if BOARD_FITS_BITBOARD
+void get_board_position(Position* position) {
+	rules_to_position(board, position);
+}
+#endif
+
 uint8_t valid_position_flag; 
 void flash_cursor(void) {
+	PROFILE_BEGIN(PROFILE_FLASH_CURSOR);
+	PROFILE_BEGIN(PROFILE_IS_VALID_POSITION);
 	valid_position_flag = is_valid_position(cursor_x, cursor_y);
+	PROFILE_END(PROFILE_IS_VALID_POSITION);
 	if (cursor_visible) {
 		// we need to flash the cursor off, it should be replaced by
 		// the colour of the piece which is at that location
@@ -356,12 +273,25 @@ void flash_cursor(void) {
 		}
 	}
 	cursor_visible = 1 - cursor_visible; //alternate between 0 and 1
+	PROFILE_END(PROFILE_FLASH_CURSOR);
 }
 
 
 
 
 
+// scroll the LED matrix to keep the cursor on it and, if it moved, redraw
+// every square now showing (only boards taller than the matrix scroll)
+static void keep_cursor_in_view(void) {
+	if (display_scroll_to(cursor_y)) {
+		for (uint8_t x = 0; x < WIDTH; x++) {
+			for (uint8_t y = 0; y < HEIGHT; y++) {
+				update_square_colour(x, y, board[x][y]);
+			}
+		}
+	}
+}
+
 //check the header file game.h for a description of what this function should do
 // (it may contain some hints as to how to move the pieces)
 void move_display_cursor(uint8_t dx, uint8_t dy) {
@@ -369,9 +299,12 @@ void move_display_cursor(uint8_t dx, uint8_t dy) {
 	uint8_t piece_at_cursor = get_piece_at(cursor_x, cursor_y);
 	update_square_colour(cursor_x, cursor_y, piece_at_cursor);
 
-	cursor_x = (cursor_x + dx) % WIDTH;
-	cursor_y = (cursor_y + dy) % HEIGHT;
+	// dx and dy are really signed (-1 is passed as 255), add a whole
+	// board on so that the wrap round works for any board size
+	cursor_x = (cursor_x + WIDTH + (int8_t)dx) % WIDTH;
+	cursor_y = (cursor_y + HEIGHT + (int8_t)dy) % HEIGHT;
 	cursor_visible = 0;
+	keep_cursor_in_view();
 
 	
 	/*suggestions for implementation:
@@ -384,20 +317,51 @@ void move_display_cursor(uint8_t dx, uint8_t dy) {
 }
 
 
-uint8_t game_over = 0;
+// take the cursor off the board and put it on (x, y), without showing it
+static void move_cursor_to(uint8_t x, uint8_t y) {
+	show_square(cursor_x, cursor_y, get_piece_at(cursor_x, cursor_y));
+	cursor_x = x;
+	cursor_y = y;
+	cursor_visible = 0;
+	if (!replaying) {
+		keep_cursor_in_view();
+	}
+}
+
+void place_piece_at(uint8_t x, uint8_t y) {
+	// move the cursor to (x, y), then place the piece there exactly as if
+	// the place button had been pushed
+	move_cursor_to(x, y);
+	place_a_piece();
+}
+
+void begin_replay(void) {
+	animation_finish();
+	replaying = 1;
+}
+
+void end_replay(void) {
+	replaying = 0;
+	// the whole board goes to the LED matrix in one update
+	for (uint8_t x = 0; x < WIDTH; x++) {
+		for (uint8_t y = 0; y < HEIGHT; y++) {
+			draw_square_colour(x, y, board[x][y]);
+		}
+	}
+	display_flush();
+	keep_cursor_in_view();
+	score_in_terminal();
+	update_move_hints();
+	led_turn_display();
+}
+
 void set_game_over(void) {
 	game_over = 1;
 }
 
 uint8_t test_valid_position(void) {
-	for (uint8_t i = 0; i < 8; i++) {
-		
-		for (uint8_t j = 0; j < 8; j++) {
-			uint8_t valid_position = is_valid_position(i, j);
-			if (valid_position == 1) {
-				return 1;
-			}
-		}
+	if (rules_has_legal_move(board, current_player)) {
+		return 1;
 	}
 	
 	if (current_player == PLAYER_1) {
@@ -409,132 +373,168 @@ uint8_t test_valid_position(void) {
 	}
 }
 uint8_t turn_timing_flag = 0; // for turning timing
+
+// the player to move passes if they have no legal move, and the game is
+// over if the other player has none either
+static void check_for_pass(void) {
+	uint8_t test_next_player = test_valid_position();
+	if (test_next_player == 0) {
+		test_next_player = test_valid_position();
+		if (test_next_player == 0) {
+			set_game_over();
+		}
+	}
+}
+
+// everything which happens after a disc has been placed at (x, y) and its
+// flips made: hand the turn over (or not, if the other player has to
+// pass) and restart the turn timer
+static void finish_move(uint8_t x, uint8_t y) {
+	save_move(x, y, turn_timing_flag);
+	if (current_player == PLAYER_1) {
+		current_player = PLAYER_2;
+		if (turn_timing_flag == 1) {
+			cancel_timed_game();
+			turn_timing();
+		}
+	} else {
+		current_player = PLAYER_1;
+		if (turn_timing_flag == 1) {
+			cancel_timed_game();
+			turn_timing();
+		}
+	}
+	if (!replaying) {
+		score_in_terminal();
+	}
+	check_for_pass();
+	if (!replaying) {
+		update_move_hints();
+	}
+}
+
 void place_a_piece(void) {
+	PROFILE_BEGIN(PROFILE_PLACE_A_PIECE);
+	// the board may have changed since the cursor last flashed (e.g. a
+	// remote move), so check the square again
+	valid_position_flag = is_valid_position(cursor_x, cursor_y);
 	if (valid_position_flag == 1) {
+		TRACE_LOG(TRACE_MOVE, (cursor_y << 4) | cursor_x);
+		HistoryMove move;
+		move.square = (cursor_y << 4) | cursor_x;
+		move.player = current_player;
 		board[cursor_x][cursor_y] = current_player;
-		update_square_colour(cursor_x, cursor_y, current_player);
-		for (uint8_t i = 0; i < 8; i++) {
-			if (need_to_check[i] == 2) {
+		show_square(cursor_x, cursor_y, current_player);
+		for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+			uint8_t length = 0;
+			if (flip_directions & (1 << d)) {
+				// flip the run of opponent pieces up to our own piece
+				// (they are shown changing by the animation)
 				uint8_t x = cursor_x;
 				uint8_t y = cursor_y;
-				if (i == 0) {
-					do {
-						x -= 1;
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x >= 0 && y <= 7); 
-
-				} else if (i == 1) {
-					do {
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (y <= 7);
-
-				} else if (i == 2) {
-					do {
-						x += 1;
-						y += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x <= 7 && y <= 7);
-
-				} else if (i == 3) {
-					do {
-						x += 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x <= 7);
-
-				} else if (i == 4) {
-					do {
-						x += 1;
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x <= 7 && y >= 0);
-
-				} else if (i == 5) {
-					do {
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (y >= 0);
-
-				} else if (i == 6) {
-					do {
-						x -= 1;
-						y -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x >= 0 && y >= 0);
-
-				} else if (i == 7) {
-					do {
-						x -= 1;
-						uint8_t obj = get_piece_at(x, y);
-						if (obj == current_player) {
-							break;
-						} 
-						board[x][y] = current_player;
-						update_square_colour(x, y, current_player);
-					} while (x >= 0);
-
+				while (rules_step(&x, &y, d) && board[x][y] != current_player) {
+					board[x][y] = current_player;
+					length++;
 				}
 			}
+			history_set_run(&move, d, length);
 		}
-		if (current_player == PLAYER_1) {
-			current_player = PLAYER_2;
-			if (turn_timing_flag == 1) {
-				cancel_timed_game();
-				turn_timing();
-			}
-		} else {
-			current_player = PLAYER_1;
-			if (turn_timing_flag == 1) {
-				cancel_timed_game();
-				turn_timing();
-			}
+		history_add(&move);
+		if (!replaying) {
+			animation_start(&move);
 		}
+		finish_move(cursor_x, cursor_y);
+	}
+	PROFILE_END(PROFILE_PLACE_A_PIECE);
+}
+
+// sets every disc 'move' flipped to 'piece', redrawing just those squares
+static void set_flipped_discs(const HistoryMove* move, uint8_t piece) {
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		uint8_t x = HISTORY_MOVE_X(move);
+		uint8_t y = HISTORY_MOVE_Y(move);
+		for (uint8_t length = history_get_run(move, d); length > 0; length--) {
+			rules_step(&x, &y, d);
+			board[x][y] = piece;
+			show_square(x, y, piece);
+		}
+	}
+}
+
+uint8_t undo_move(void) {
+	HistoryMove move;
+	animation_finish();
+	if (!history_undo(&move)) {
+		return 0;
+	}
+	uint8_t x = HISTORY_MOVE_X(&move);
+	uint8_t y = HISTORY_MOVE_Y(&move);
+	move_cursor_to(x, y);
+	board[x][y] = EMPTY_SQUARE;
+	show_square(x, y, EMPTY_SQUARE);
+	set_flipped_discs(&move, RULES_OPPONENT(move.player));
+	save_undo();
+
+	// it is the turn of whoever played the move again, and the game
+	// can't be over (even if it was lost on time)
+	current_player = move.player;
+	game_over = 0;
+	game_over_flag = 0;
+	if (turn_timing_flag == 1) {
+		cancel_timed_game();
+		turn_timing();
+	}
+	if (!replaying) {
 		score_in_terminal();
-		uint8_t test_next_player = test_valid_position();
-		if (test_next_player == 0) {
-			test_next_player = test_valid_position();
-			if (test_next_player == 0) {
-				set_game_over();
-			}
+		update_move_hints();
+		led_turn_display();
+	}
+	return 1;
+}
+
+uint8_t redo_move(void) {
+	HistoryMove move;
+	animation_finish();
+	if (!history_redo(&move)) {
+		return 0;
+	}
+	uint8_t x = HISTORY_MOVE_X(&move);
+	uint8_t y = HISTORY_MOVE_Y(&move);
+	move_cursor_to(x, y);
+	current_player = move.player;
+	board[x][y] = move.player;
+	show_square(x, y, move.player);
+	set_flipped_discs(&move, move.player);
+	finish_move(x, y);
+	if (!replaying) {
+		led_turn_display();
+	}
+	return 1;
+}
+
+uint8_t hints_enabled = 0;
+void update_move_hints(void) {
+#if BOARD_FITS_BITBOARD
+	BitBoard hints = 0;
+	if (hints_enabled) {
+		// all of the legal squares are found at once from the bitboards,
+		// rather than checking every square with is_valid_position()
+		Position position;
+		get_board_position(&position);
+		if (current_player == PLAYER_1) {
+			hints = bitboard_legal_moves(position.p1, position.p2);
+		} else {
+			hints = bitboard_legal_moves(position.p2, position.p1);
 		}
 	}
-	
+	show_hint_squares(hints, current_player);
+#endif
+	// (bigger boards don't have move hints)
+}
+
+void toggle_move_hints(void) {
+	hints_enabled = 1 - hints_enabled;
+	update_move_hints();
 }
 
 
@@ -552,11 +552,11 @@ void led_turn_display(void) {
 	}
 }
 
-uint8_t red_score, green_score;
+uint16_t red_score, green_score;
 
-uint8_t game_over_flag = 0;
 
 void score_in_terminal(void) {
+	PROFILE_BEGIN(PROFILE_SCORE_IN_TERMINAL);
 	if (game_over_flag == 0) {
 		red_score = 0;
 		green_score = 0;
@@ -571,15 +571,22 @@ void score_in_terminal(void) {
 		}
 	}
 	
-	move_terminal_cursor(10,10);
-	printf_P(PSTR("Red Score: "));
+	// only the numbers are sent, as a status line so that the game never
+	// waits for the terminal to catch up
+	terminal_begin_status();
 	move_terminal_cursor(35,10);
-	printf_P(PSTR("%10d"), red_score);
+	terminal_print_number(red_score, 10);
+	move_terminal_cursor(35,12);
+	terminal_print_number(green_score, 10);
+	terminal_end_status();
+	PROFILE_END(PROFILE_SCORE_IN_TERMINAL);
+}
 
+void score_labels_in_terminal(void) {
+	move_terminal_cursor(10,10);
+	terminal_print_P(PSTR("Red Score: "));
 	move_terminal_cursor(10,12);
-	printf_P(PSTR("Green Score: "));
-	move_terminal_cursor(35,12);
-	printf_P(PSTR("%10d"), green_score);
+	terminal_print_P(PSTR("Green Score: "));
 }
 
 
@@ -590,7 +597,7 @@ void score_in_seven_seg(void) {
 	if (turn_timing_flag == 0) {
 		DDRC = 0xFF;                  //DDRA = 0xFF;
 		DDRA |= (1 << 2);     //DDRC |= (1 << 0);
-		uint8_t score = 0;
+		uint16_t score = 0;
 		if (current_player == PLAYER_1) {
 			score = red_score;
 		} else {
@@ -613,7 +620,7 @@ void score_in_seven_seg(void) {
 				PORTC = seven_seg[score % 10];  //else
 			} else if (call_times % 2 == 0) {
 				PORTA |= (1 << PINA2);           //left
-				PORTC = seven_seg[score / 10];  //0
+				PORTC = seven_seg[(score / 10) % 10];  //0
 			} 
 			// if (current_time >= last_flash_time + 8) {
 			// 	last_flash_time = current_time;
@@ -665,9 +672,9 @@ void turn_timing(void) {
 		game_over_flag = 1;
 		if (current_player == PLAYER_1) {
 			red_score = 0;
-			green_score = 64;
+			green_score = BOARD_SQUARES;
 		} else {
-			red_score = 64;
+			red_score = BOARD_SQUARES;
 			green_score = 0;
 		}
 		score_in_terminal();
@@ -679,12 +686,55 @@ void turn_timing(void) {
 	if (current_time_l >= last_time + 1000 && time_count != 0) {
 		if (is_game_pause == 0) {
 			time_count -= 1;
+			TRACE_LOG(TRACE_TURN_TICK, time_count);
 		}
 		last_time += 1000;
 	}
 	change_side_flag += 1;
 }
 
+#if BOARD_FITS_BITBOARD
+void set_board_position(const Position* position, uint8_t player) {
+	save_position(position, player);
+	animation_finish();
+	// the moves before the new position can't be undone onto it
+	history_clear();
+	// only redraw the squares which actually change. The bitboards are
+	// read a row (byte) at a time
+	BitBoard p1 = position->p1;
+	BitBoard p2 = position->p2;
+	for (uint8_t y = 0; y < HEIGHT; y++) {
+		uint8_t p1_row = (uint8_t)p1;
+		uint8_t p2_row = (uint8_t)p2;
+		for (uint8_t x = 0; x < WIDTH; x++) {
+			uint8_t piece = EMPTY_SQUARE;
+			if (p1_row & 1) {
+				piece = PLAYER_1;
+			} else if (p2_row & 1) {
+				piece = PLAYER_2;
+			}
+			if (board[x][y] != piece) {
+				board[x][y] = piece;
+				show_square(x, y, piece);
+			}
+			p1_row >>= 1;
+			p2_row >>= 1;
+		}
+		p1 >>= 8;
+		p2 >>= 8;
+	}
+	current_player = player;
+	game_over = 0;
+	game_over_flag = 0;
+	// the same as after a move, 'player' may have to pass
+	check_for_pass();
+	if (!replaying) {
+		score_in_terminal();
+		update_move_hints();
+	}
+}
+#endif
+
 void cancel_timed_game(void) {
 	turn_timing_flag = 0;
 	change_side_flag = 0;
@@ -10,6 +10,9 @@
 #define GAME_H_
 
 #include <inttypes.h>
+#include "bitboard.h"
+#include "board.h"
+#include "position.h"
 
 // initialise the display of the board, this creates the internal board
 // and also updates the display of the board
@@ -32,7 +35,50 @@ void move_display_cursor(uint8_t dx, uint8_t dy);
 
 void place_a_piece(void);
 
+// moves the cursor to (x, y) and places a piece there for the current
+// player, if that is a valid position. Used by the computer opponent
+void place_piece_at(uint8_t x, uint8_t y);
+
+// takes back the last move, making it that player's turn again. Returns
+// 0 if there are no moves to take back
+uint8_t undo_move(void);
+
+// plays the last move taken back by undo_move() again. Returns 0 if there
+// isn't one (or a different move has been played since)
+uint8_t redo_move(void);
+
+// between these, moves and undos change the board (and history) without
+// drawing anything, animating or writing the score. end_replay() then
+// draws the board that results once. Used to resume a saved game, and for
+// moves pasted in on the command line
+void begin_replay(void);
+void end_replay(void);
+
+// returns the player whose turn it is, PLAYER_1 or PLAYER_2
+uint8_t get_current_player(void);
+
+// recalculates the legal squares for the player to move and shows them on
+// the LED matrix if move hints are turned on. Called once per turn
+void update_move_hints(void);
+
+// turns the move hint display on or off
+void toggle_move_hints(void);
+
+// returns 1 if the player to move can place a piece at (x, y)
+uint8_t is_legal_move(uint8_t x, uint8_t y);
+
+#if BOARD_FITS_BITBOARD
+// replaces the board with the given position and makes it 'player's turn
+void set_board_position(const Position* position, uint8_t player);
+
+// fills in the current position
+void get_board_position(Position* position);
+#endif
+
+// score_labels_in_terminal() draws the labels once the terminal is cleared,
+// score_in_terminal() the scores themselves
 void score_in_terminal(void);
+void score_labels_in_terminal(void);
 void score_in_seven_seg(void);
 void led_turn_display(void);
 void turn_timing(void);
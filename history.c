@@ -0,0 +1,77 @@
+/*
+ * history.c
+ *
+ * Move history for undo and redo. See history.h.
+ *
+ * The moves are kept in a ring so that, once it is full, adding a move
+ * drops the oldest. 'undo_count' moves before 'next' can be undone and
+ * 'redo_count' moves from 'next' on can be redone.
+ */
+
+#include <stdint.h>
+
+#include "history.h"
+
+static HistoryMove moves[HISTORY_SIZE];
+static uint8_t next;
+static uint8_t undo_count;
+static uint8_t redo_count;
+
+void history_clear(void) {
+	next = 0;
+	undo_count = 0;
+	redo_count = 0;
+}
+
+void history_add(const HistoryMove* move) {
+	moves[next] = *move;
+	next = (next + 1) % HISTORY_SIZE;
+	if (undo_count < HISTORY_SIZE) {
+		undo_count++;
+	}
+	redo_count = 0;
+}
+
+uint8_t history_undo(HistoryMove* move) {
+	if (undo_count == 0) {
+		return 0;
+	}
+	next = (next + HISTORY_SIZE - 1) % HISTORY_SIZE;
+	undo_count--;
+	redo_count++;
+	*move = moves[next];
+	return 1;
+}
+
+uint8_t history_redo(HistoryMove* move) {
+	if (redo_count == 0) {
+		return 0;
+	}
+	*move = moves[next];
+	next = (next + 1) % HISTORY_SIZE;
+	redo_count--;
+	undo_count++;
+	return 1;
+}
+
+uint8_t history_length(void) {
+	return undo_count;
+}
+
+uint8_t history_redo_length(void) {
+	return redo_count;
+}
+
+void history_set_run(HistoryMove* move, uint8_t direction, uint8_t length) {
+	uint8_t* runs = &move->runs[direction >> 1];
+	if (direction & 1) {
+		*runs = (*runs & 0x0F) | (length << 4);
+	} else {
+		*runs = (*runs & 0xF0) | length;
+	}
+}
+
+uint8_t history_get_run(const HistoryMove* move, uint8_t direction) {
+	uint8_t runs = move->runs[direction >> 1];
+	return (direction & 1) ? (runs >> 4) : (runs & 0x0F);
+}
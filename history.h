@@ -0,0 +1,63 @@
+/*
+ * history.h
+ *
+ * The moves played so far in the current game, so that they can be taken
+ * back (undone) and played again (redone).
+ *
+ * Each move is stored with the number of discs it flipped in each
+ * direction, so undoing it only has to visit the discs which actually
+ * changed rather than rebuilding the board. Passes aren't stored
+ * separately, each move remembers whose move it was instead.
+ *
+ * The history holds a whole 8x8 game. On bigger boards only the most
+ * recent HISTORY_SIZE moves can be undone.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stdint.h>
+
+#include "rules.h"
+
+#define HISTORY_SIZE 60
+
+typedef struct {
+	uint8_t square;		// (y << 4) | x
+	uint8_t player;		// who placed the disc
+	// discs flipped in each direction, direction d is in the low nibble
+	// of runs[d / 2] if d is even, the high nibble if it is odd
+	uint8_t runs[RULES_NUM_DIRECTIONS / 2];
+} HistoryMove;
+
+#define HISTORY_MOVE_X(move) ((move)->square & 0x0F)
+#define HISTORY_MOVE_Y(move) ((move)->square >> 4)
+
+// forget every move, e.g. at the start of a game
+void history_clear(void);
+
+// adds a move which has just been played. Any moves which had been undone
+// can no longer be redone
+void history_add(const HistoryMove* move);
+
+// takes the most recent move off the history and copies it into 'move'.
+// Returns 0 if there is nothing to undo
+uint8_t history_undo(HistoryMove* move);
+
+// puts the most recently undone move back on the history and copies it
+// into 'move'. Returns 0 if there is nothing to redo
+uint8_t history_redo(HistoryMove* move);
+
+// number of moves which can be undone
+uint8_t history_length(void);
+
+// number of moves which can be redone
+uint8_t history_redo_length(void);
+
+// sets the number of discs 'move' flipped in 'direction'
+void history_set_run(HistoryMove* move, uint8_t direction, uint8_t length);
+
+// returns the number of discs 'move' flipped in 'direction'
+uint8_t history_get_run(const HistoryMove* move, uint8_t direction);
+
+#endif /* HISTORY_H_ */
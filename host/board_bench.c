@@ -0,0 +1,125 @@
+/*
+ * board_bench.c
+ *
+ * Measures how move generation and game tree search scale with the board
+ * size. The board size is fixed when building (see board.h), so build once
+ * per size:
+ *		gcc -O2 -DBOARD_WIDTH=10 -DBOARD_HEIGHT=10 -o board_bench \
+ *				board_bench.c ../rules.c ../bitboard.c ../position.c
+ *		./board_bench [depth]
+ *
+ * For each depth from 1 up it counts every position reachable from the
+ * start (a "perft" count) using the square by square rules, and also with
+ * bitboards if the board fits in one. Both counts must agree.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../rules.h"
+#include "../display.h"
+
+typedef uint8_t Board[BOARD_WIDTH][BOARD_HEIGHT];
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start_position(Board board) {
+	for (int x = 0; x < BOARD_WIDTH; x++) {
+		for (int y = 0; y < BOARD_HEIGHT; y++) {
+			board[x][y] = EMPTY_SQUARE;
+		}
+	}
+	board[BOARD_WIDTH / 2 - 1][BOARD_HEIGHT / 2 - 1] = PLAYER_1;
+	board[BOARD_WIDTH / 2][BOARD_HEIGHT / 2] = PLAYER_1;
+	board[BOARD_WIDTH / 2 - 1][BOARD_HEIGHT / 2] = PLAYER_2;
+	board[BOARD_WIDTH / 2][BOARD_HEIGHT / 2 - 1] = PLAYER_2;
+}
+
+// leaf positions 'depth' plies on from 'board' with 'player' to move. A
+// pass counts as a ply, two passes in a row end the game
+static unsigned long perft(Board board, uint8_t player, int depth, int passed) {
+	if (depth == 0) {
+		return 1;
+	}
+	unsigned long nodes = 0;
+	int moved = 0;
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			uint8_t directions = rules_flip_directions(board, x, y, player);
+			if (!directions) {
+				continue;
+			}
+			Board next;
+			for (int i = 0; i < BOARD_WIDTH; i++) {
+				for (int j = 0; j < BOARD_HEIGHT; j++) {
+					next[i][j] = board[i][j];
+				}
+			}
+			rules_make_move(next, x, y, player, directions);
+			nodes += perft(next, RULES_OPPONENT(player), depth - 1, 0);
+			moved = 1;
+		}
+	}
+	if (!moved) {
+		if (passed) {
+			return 1;
+		}
+		nodes = perft(board, RULES_OPPONENT(player), depth - 1, 1);
+	}
+	return nodes;
+}
+
+#if BOARD_FITS_BITBOARD
+static unsigned long perft_bitboard(BitBoard own, BitBoard opp, int depth, int passed) {
+	if (depth == 0) {
+		return 1;
+	}
+	BitBoard moves = bitboard_legal_moves(own, opp);
+	if (moves == 0) {
+		if (passed) {
+			return 1;
+		}
+		return perft_bitboard(opp, own, depth - 1, 1);
+	}
+	unsigned long nodes = 0;
+	while (moves) {
+		uint8_t square = bitboard_pop_lowest(&moves);
+		BitBoard flips = bitboard_flips(own, opp, square);
+		nodes += perft_bitboard(opp & ~flips, own | flips | BITBOARD_BIT(square),
+				depth - 1, 0);
+	}
+	return nodes;
+}
+#endif
+
+int main(int argc, char** argv) {
+	int max_depth = argc > 1 ? atoi(argv[1]) : 6;
+	Board board;
+	start_position(board);
+	printf("%dx%d board\n", BOARD_WIDTH, BOARD_HEIGHT);
+	printf("depth %14s %12s %12s\n", "positions", "squares/s", "bitboard/s");
+	for (int depth = 1; depth <= max_depth; depth++) {
+		double start = now_seconds();
+		unsigned long nodes = perft(board, PLAYER_1, depth, 0);
+		double seconds = now_seconds() - start;
+		printf("%5d %14lu %12.0f", depth, nodes, nodes / seconds);
+#if BOARD_FITS_BITBOARD
+		Position position;
+		rules_to_position(board, &position);
+		start = now_seconds();
+		unsigned long bitboard_nodes = perft_bitboard(position.p1, position.p2, depth, 0);
+		seconds = now_seconds() - start;
+		printf(" %12.0f", bitboard_nodes / seconds);
+		if (bitboard_nodes != nodes) {
+			printf("  MISMATCH (%lu)", bitboard_nodes);
+		}
+#endif
+		printf("\n");
+	}
+	return 0;
+}
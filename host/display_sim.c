@@ -0,0 +1,231 @@
+/*
+ * display_sim.c
+ *
+ * Measures the LED matrix traffic of real games without a board. The
+ * firmware's game and display code is run against the simulated hardware
+ * in sim/ (see sim/sim.h), playing random games, and the bytes and
+ * commands sent to the LED matrix are counted for every frame. Build with
+ * sim/build.sh:
+ *		sh sim/build.sh display_sim
+ *		./display_sim [-g games] [-s seed] [-t] [-i dir] [-v]
+ *
+ * A frame is 10ms of simulated time, in which the main loop does what
+ * play_game() does: steps the flip animation, flashes the cursor, shows
+ * the score and sends any serial output. A move is made every
+ * MOVE_INTERVAL_MS.
+ *		-t	draws the display on the terminal after each move
+ *		-i	writes a PPM image into dir for each frame the display changed
+ *		-v	prints the traffic of each frame which sent anything
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <avr/interrupt.h>
+
+#include "sim/sim.h"
+#include "../animation.h"
+#include "../display.h"
+#include "../game.h"
+#include "../save.h"
+#include "../serialio.h"
+#include "../terminalio.h"
+#include "../timer0.h"
+#include "../ledmatrix.h"
+
+#define FRAME_MS 10
+#define MOVE_INTERVAL_MS 400
+#define FLASH_MS 500
+#define SEVEN_SEG_MS 4
+
+typedef struct {
+	uint32_t frames;
+	uint32_t busy_frames;		// frames which sent anything
+	uint32_t moves;
+	uint64_t bytes;
+	uint32_t max_bytes;
+	uint64_t commands[SIM_LED_NUM_CMDS];
+	uint64_t pixels_changed;
+	uint64_t spi_ns;
+	uint64_t max_spi_ns;
+} Totals;
+
+static Totals totals;
+static uint8_t verbose;
+static uint8_t render_terminal;
+static const char* image_dir;
+static uint32_t image_count;
+
+static void add_frame(const SimLedStats* stats) {
+	totals.frames++;
+	if (stats->bytes == 0) {
+		return;
+	}
+	totals.busy_frames++;
+	totals.bytes += stats->bytes;
+	if (stats->bytes > totals.max_bytes) {
+		totals.max_bytes = stats->bytes;
+	}
+	for (uint8_t i = 0; i < SIM_LED_NUM_CMDS; i++) {
+		totals.commands[i] += stats->commands[i];
+	}
+	totals.pixels_changed += stats->pixels_changed;
+	totals.spi_ns += stats->spi_ns;
+	if (stats->spi_ns > totals.max_spi_ns) {
+		totals.max_spi_ns = stats->spi_ns;
+	}
+
+	if (verbose) {
+		fprintf(stderr, "frame %6u: %4u bytes %8.3f ms %3u pixels changed:",
+				totals.frames, stats->bytes, stats->spi_ns / 1e6,
+				stats->pixels_changed);
+		for (uint8_t i = 0; i < SIM_LED_NUM_CMDS; i++) {
+			if (stats->commands[i]) {
+				fprintf(stderr, " %u %s", stats->commands[i], sim_led_command_name(i));
+			}
+		}
+		fprintf(stderr, "\n");
+	}
+	if (image_dir && stats->pixels_changed) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/frame%06u.ppm", image_dir, image_count++);
+		if (sim_render_ppm(path) != 0) {
+			fprintf(stderr, "can't write %s\n", path);
+			exit(1);
+		}
+	}
+}
+
+// runs the main loop for one frame and counts what it sent
+static void run_frame(void) {
+	static uint32_t last_flash_time;
+	static uint32_t last_seven_seg_time;
+	uint32_t end = get_current_time() + FRAME_MS;
+	while (get_current_time() < end) {
+		animation_update();
+		if (get_current_time() >= last_flash_time + FLASH_MS) {
+			flash_cursor();
+			last_flash_time = get_current_time();
+		}
+		if (get_current_time() >= last_seven_seg_time + SEVEN_SEG_MS) {
+			score_in_seven_seg();
+			last_seven_seg_time = get_current_time();
+		}
+		update_terminal_board();
+		serial_flush_pending();
+	}
+	SimLedStats stats;
+	sim_led_stats(&stats);
+	add_frame(&stats);
+}
+
+// a random legal move for the player to move, as (y << 4) | x. Returns
+// 0xFF if there isn't one
+static uint8_t random_move(void) {
+	uint8_t moves[BOARD_WIDTH * BOARD_HEIGHT];
+	uint8_t count = 0;
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if (is_legal_move(x, y)) {
+				moves[count++] = (y << 4) | x;
+			}
+		}
+	}
+	return count ? moves[rand() % count] : 0xFF;
+}
+
+static void play_random_game(void) {
+	clear_terminal();
+	initialise_board();
+	save_new_game();
+	score_in_terminal();
+	while (!is_game_over()) {
+		uint8_t move = random_move();
+		if (move == 0xFF) {
+			break;
+		}
+		place_piece_at(move & 0x0F, move >> 4);
+		totals.moves++;
+		for (uint8_t i = 0; i < MOVE_INTERVAL_MS / FRAME_MS; i++) {
+			run_frame();
+		}
+		if (render_terminal) {
+			printf("\x1b[H");
+			sim_render_terminal(stdout);
+		}
+	}
+	save_game_over();
+	// let the last animation and score finish
+	for (uint8_t i = 0; i < 100; i++) {
+		run_frame();
+	}
+}
+
+static void print_totals(void) {
+	printf("%u moves, %u frames of %dms, %u of them sent to the LED matrix\n",
+			totals.moves, totals.frames, FRAME_MS, totals.busy_frames);
+	if (totals.busy_frames == 0) {
+		return;
+	}
+	printf("bytes:          %llu, %.1f per busy frame, %u at most\n",
+			(unsigned long long)totals.bytes,
+			(double)totals.bytes / totals.busy_frames, totals.max_bytes);
+	printf("SPI time:       %.3f ms per busy frame, %.3f ms at most\n",
+			totals.spi_ns / 1e6 / totals.busy_frames, totals.max_spi_ns / 1e6);
+	printf("pixels changed: %llu, %.2f bytes each\n",
+			(unsigned long long)totals.pixels_changed,
+			totals.pixels_changed ? (double)totals.bytes / totals.pixels_changed : 0.0);
+	printf("per move:       %.1f bytes\n", (double)totals.bytes / totals.moves);
+	printf("commands:");
+	for (uint8_t i = 0; i < SIM_LED_NUM_CMDS; i++) {
+		if (totals.commands[i]) {
+			printf(" %llu %s", (unsigned long long)totals.commands[i],
+					sim_led_command_name(i));
+		}
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	int games = 10;
+	unsigned seed = 1;
+	int option;
+	while ((option = getopt(argc, argv, "g:s:ti:v")) != -1) {
+		switch (option) {
+			case 'g': games = atoi(optarg); break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			case 't': render_terminal = 1; break;
+			case 'i': image_dir = optarg; break;
+			case 'v': verbose = 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-g games] [-s seed] [-t] [-i dir] [-v]\n",
+						argv[0]);
+				return 1;
+		}
+	}
+	srand(seed);
+
+	// the same set up as initialise_hardware() in project.c, less the
+	// buttons. Serial output is only counted
+	ledmatrix_setup();
+	init_serial_stdio(19200, 0);
+	init_timer0();
+	init_save();
+	sei();
+	initialise_display();
+	if (render_terminal) {
+		printf("\x1b[2J");
+	}
+
+	SimLedStats stats;
+	sim_led_stats(&stats);		// don't count the set up
+	for (int i = 0; i < games; i++) {
+		play_random_game();
+	}
+	print_totals();
+	printf("serial bytes:   %u\n", sim_uart_bytes_sent());
+	return 0;
+}
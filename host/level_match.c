@@ -0,0 +1,138 @@
+/*
+ * level_match.c
+ *
+ * Plays the computer opponent's levels (see ai.h) against each other with
+ * the same search code as the firmware. Searches are limited by node
+ * counts, so a game here is move for move the game the board would play,
+ * and a bug report only needs the levels and the moves:
+ *		gcc -O2 -Isim -o level_match level_match.c ../ai.c ../moveorder.c \
+ *				../bitboard.c ../stability.c
+ *		./level_match				every level against every other
+ *		./level_match red green		one game, move by move
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../ai.h"
+#include "../bitboard.h"
+#include "../board.h"
+#include "../display.h"
+
+#if !BOARD_FITS_BITBOARD
+#error "the search only covers boards which fit in a bitboard"
+#endif
+
+typedef struct {
+	uint8_t red;			// discs at the end
+	uint8_t green;
+	uint32_t key;			// FNV-1a hash of the squares played
+	uint32_t max_nodes[2];	// most nodes one move took, red then green
+	uint32_t total_nodes[2];
+	uint16_t moves[2];
+} GameResult;
+
+// the search reads the time to measure its steps, which doesn't matter here
+uint32_t get_current_time(void) {
+	return 0;
+}
+
+static void play_game(uint8_t red_level, uint8_t green_level, uint8_t verbose,
+		GameResult* result) {
+	uint8_t left = BOARD_WIDTH / 2 - 1;
+	uint8_t bottom = BOARD_HEIGHT / 2 - 1;
+	BitBoard discs[2];
+	discs[0] = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom + 1));
+	discs[1] = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom + 1)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom));
+	uint8_t side = 0;		// red (PLAYER_1) moves first
+	uint8_t passes = 0;
+	*result = (GameResult){ .key = 2166136261u };
+
+	while (passes < 2) {
+		BitBoard own = discs[side];
+		BitBoard opp = discs[1 - side];
+		if (bitboard_legal_moves(own, opp) == 0) {
+			passes++;
+			side = 1 - side;
+			continue;
+		}
+		passes = 0;
+		ai_set_level(side == 0 ? red_level : green_level);
+		ai_start_level_search(own, opp);
+		while (!ai_search_step(0xFFFF)) {
+			;
+		}
+		uint8_t square = ai_best_move();
+		uint32_t nodes = ai_nodes_searched();
+		BitBoard flips = bitboard_flips(own, opp, square);
+		discs[side] = own | flips | BITBOARD_BIT(square);
+		discs[1 - side] = opp & ~flips;
+
+		result->key = (result->key ^ square) * 16777619u;
+		result->total_nodes[side] += nodes;
+		result->moves[side]++;
+		if (nodes > result->max_nodes[side]) {
+			result->max_nodes[side] = nodes;
+		}
+		if (verbose) {
+			printf("%3d %-5s %c%-2d %6u nodes\n", result->moves[0] + result->moves[1],
+					side == 0 ? "red" : "green", 'a' + BITBOARD_SQUARE_X(square),
+					BITBOARD_SQUARE_Y(square) + 1, nodes);
+		}
+		side = 1 - side;
+	}
+	result->red = bitboard_count(discs[0]);
+	result->green = bitboard_count(discs[1]);
+}
+
+int main(int argc, char** argv) {
+	GameResult result;
+	if (argc == 3) {
+		uint8_t red = atoi(argv[1]);
+		uint8_t green = atoi(argv[2]);
+		if (red < 1 || red > AI_NUM_LEVELS || green < 1 || green > AI_NUM_LEVELS) {
+			fprintf(stderr, "levels are 1 to %d\n", AI_NUM_LEVELS);
+			return 1;
+		}
+		play_game(red, green, 1, &result);
+		printf("red %d green %d, game %08x\n", result.red, result.green, result.key);
+		return 0;
+	}
+
+	// the largest and mean node count of a move at each level
+	uint32_t max_nodes[AI_NUM_LEVELS] = {0};
+	uint32_t total_nodes[AI_NUM_LEVELS] = {0};
+	uint32_t moves[AI_NUM_LEVELS] = {0};
+
+	printf("%dx%d board, red (across) against green (down), red's discs - green's\n",
+			BOARD_WIDTH, BOARD_HEIGHT);
+	printf("     ");
+	for (uint8_t red = 1; red <= AI_NUM_LEVELS; red++) {
+		printf(" %5d", red);
+	}
+	printf("\n");
+	for (uint8_t green = 1; green <= AI_NUM_LEVELS; green++) {
+		printf("%5d", green);
+		for (uint8_t red = 1; red <= AI_NUM_LEVELS; red++) {
+			play_game(red, green, 0, &result);
+			printf(" %+5d", result.red - result.green);
+			for (uint8_t side = 0; side < 2; side++) {
+				uint8_t level = (side == 0 ? red : green) - 1;
+				total_nodes[level] += result.total_nodes[side];
+				moves[level] += result.moves[side];
+				if (result.max_nodes[side] > max_nodes[level]) {
+					max_nodes[level] = result.max_nodes[side];
+				}
+			}
+		}
+		printf("\n");
+	}
+	printf("\nlevel  nodes/move  most nodes\n");
+	for (uint8_t level = 0; level < AI_NUM_LEVELS; level++) {
+		printf("%5d %11.0f %11u\n", level + 1, (double)total_nodes[level] / moves[level],
+				max_nodes[level]);
+	}
+	return 0;
+}
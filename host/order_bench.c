@@ -0,0 +1,165 @@
+/*
+ * order_bench.c
+ *
+ * Measures how much each part of the move ordering (see moveorder.h)
+ * shrinks the search. Runs the computer opponent's search over a fixed set
+ * of positions with each combination of ordering flags and prints the
+ * nodes visited, against the moves being tried lowest square first:
+ *		gcc -O2 -Isim -o order_bench order_bench.c ../ai.c ../moveorder.c \
+ *				../bitboard.c ../stability.c
+ *		./order_bench [depth]
+ *
+ * Whatever order the moves are tried in, the search must give each
+ * position the same value.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../ai.h"
+#include "../moveorder.h"
+#include "../bitboard.h"
+#include "../board.h"
+
+#if !BOARD_FITS_BITBOARD
+#error "the search only covers boards which fit in a bitboard"
+#endif
+
+// positions are taken from random games, one NUM_POSITIONS_APART plies
+// further into its game than the last
+#define NUM_POSITIONS 24
+#define FIRST_POSITION_PLY 8
+#define NUM_POSITIONS_APART 2
+
+typedef struct {
+	BitBoard own;		// discs of the side to move
+	BitBoard opp;
+} BenchPosition;
+
+static const struct {
+	const char* name;
+	uint8_t flags;
+} orderings[] = {
+	{ "lowest square first", 0 },
+	{ "killers", MOVEORDER_KILLERS },
+	{ "square priorities", MOVEORDER_SQUARES },
+	{ "history", MOVEORDER_HISTORY },
+	{ "killers + history", MOVEORDER_KILLERS | MOVEORDER_HISTORY },
+	{ "all", MOVEORDER_ALL }
+};
+#define NUM_ORDERINGS (sizeof(orderings) / sizeof(orderings[0]))
+
+// the search reads the time to measure its steps, which doesn't matter here
+uint32_t get_current_time(void) {
+	return 0;
+}
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift, so the positions are the same with any C library
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+// plays 'plies' random moves (passes count) from the start with the
+// random numbers from 'seed'. Returns 0 if the game ends first, or the
+// side to move has no move at the end
+static uint8_t random_position(uint32_t seed, uint8_t plies, BenchPosition* position) {
+	uint8_t left = BOARD_WIDTH / 2 - 1;
+	uint8_t bottom = BOARD_HEIGHT / 2 - 1;
+	BitBoard own = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom + 1));
+	BitBoard opp = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom + 1)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom));
+	random_state = seed;
+	for (uint8_t ply = 0; ply < plies; ply++) {
+		BitBoard moves = bitboard_legal_moves(own, opp);
+		if (moves) {
+			uint8_t choice = next_random() % bitboard_count(moves);
+			uint8_t square = bitboard_pop_lowest(&moves);
+			while (choice--) {
+				square = bitboard_pop_lowest(&moves);
+			}
+			BitBoard flips = bitboard_flips(own, opp, square);
+			own |= flips | BITBOARD_BIT(square);
+			opp &= ~flips;
+		} else if (bitboard_legal_moves(opp, own) == 0) {
+			return 0;
+		}
+		BitBoard swap = own;
+		own = opp;
+		opp = swap;
+	}
+	position->own = own;
+	position->opp = opp;
+	return bitboard_legal_moves(own, opp) != 0;
+}
+
+static uint32_t search(const BenchPosition* position, uint8_t depth, int16_t* score) {
+	ai_start_search(position->own, position->opp, depth);
+	while (!ai_search_step(0xFFFF)) {
+		;
+	}
+	*score = ai_best_score();
+	return ai_nodes_searched();
+}
+
+int main(int argc, char** argv) {
+	uint8_t depth = argc > 1 ? atoi(argv[1]) : 6;
+	if (depth < 1 || depth > AI_MAX_DEPTH) {
+		fprintf(stderr, "depth must be 1 to %d\n", AI_MAX_DEPTH);
+		return 1;
+	}
+
+	BenchPosition positions[NUM_POSITIONS];
+	uint8_t num_positions = 0;
+	for (uint32_t seed = 1; num_positions < NUM_POSITIONS; seed++) {
+		uint8_t plies = FIRST_POSITION_PLY + num_positions * NUM_POSITIONS_APART;
+		if (random_position(seed, plies, &positions[num_positions])) {
+			num_positions++;
+		}
+	}
+
+	int16_t scores[NUM_POSITIONS];
+	uint32_t unordered_nodes = 0;
+	int errors = 0;
+	printf("%dx%d board, %d positions, depth %d\n", BOARD_WIDTH, BOARD_HEIGHT,
+			NUM_POSITIONS, depth);
+	printf("%-20s %10s %8s %12s\n", "ordering", "nodes", "of first", "nodes/s");
+	for (uint8_t i = 0; i < NUM_ORDERINGS; i++) {
+		moveorder_set_flags(orderings[i].flags);
+		uint32_t nodes = 0;
+		double start = now_seconds();
+		for (uint8_t p = 0; p < NUM_POSITIONS; p++) {
+			int16_t score;
+			nodes += search(&positions[p], depth, &score);
+			if (i == 0) {
+				scores[p] = score;
+			} else if (score != scores[p]) {
+				printf("position %d: %s gives %d, not %d\n", p + 1,
+						orderings[i].name, score, scores[p]);
+				errors++;
+			}
+		}
+		double seconds = now_seconds() - start;
+		if (i == 0) {
+			unordered_nodes = nodes;
+		}
+		printf("%-20s %10u %7.1f%% %12.0f\n", orderings[i].name, nodes,
+				100.0 * nodes / unordered_nodes, nodes / seconds);
+	}
+	if (errors) {
+		printf("%d ERRORS\n", errors);
+	}
+	return errors ? 1 : 0;
+}
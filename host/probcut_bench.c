@@ -0,0 +1,305 @@
+/*
+ * probcut_bench.c
+ *
+ * Fits the Multi-ProbCut table in ai.c, and measures what ProbCut gains
+ * on a fixed set of test positions. Built with the firmware's search code:
+ *		gcc -O2 -Isim -o probcut_bench probcut_bench.c ../ai.c \
+ *				../moveorder.c ../bitboard.c ../stability.c -lm
+ *		./probcut_bench -c [positions] [-t threshold]
+ *		./probcut_bench
+ *
+ * With -c, positions from random games are searched to every depth up to
+ * AI_MAX_DEPTH with the strongest level's evaluation. For each stage of
+ * the game and each pair of depths used by a check, the deep values are
+ * fitted to the shallow ones by least squares. The margin is the threshold
+ * (1.5 unless given) times the standard deviation of the fit's errors.
+ * The table is printed ready to replace the body of probcut_checks[] in
+ * ai.c, and the quality of each fit goes to stderr.
+ *
+ * Otherwise the strongest level searches each test position, first
+ * without ProbCut and then with it. The table prints how deep each gets
+ * in its node budget. It also prints how often each picks the move a full
+ * AI_MAX_DEPTH ply search picks. The last column is how much worse the
+ * move picked is, by that search's values. A last line sums up the trade:
+ * the depth ProbCut gains against the value it loses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../ai.h"
+#include "../bitboard.h"
+#include "../board.h"
+
+#if !BOARD_FITS_BITBOARD
+#error "the search only covers boards which fit in a bitboard"
+#endif
+
+#define DEFAULT_CALIBRATION_POSITIONS 200
+#define DEFAULT_THRESHOLD 1.5
+// values at least this far from 0 are game results (see SCORE_WIN_SCALE
+// in ai.c), which don't follow the evaluation, and are left out of fits
+#define MAX_FIT_VALUE 1024
+// fewer samples than this and a check isn't used
+#define MIN_SAMPLES 20
+#define NUM_DEPTHS (AI_MAX_DEPTH - AI_PROBCUT_MIN_DEPTH + 1)
+
+#define NUM_TEST_POSITIONS 30
+// test positions come from different random games than those fitted to
+#define TEST_SEED 1
+#define CALIBRATION_SEED 100000
+
+typedef struct {
+	BitBoard own;		// discs of the side to move
+	BitBoard opp;
+} BenchPosition;
+
+// the search reads the time to measure its steps, which doesn't matter here
+uint32_t get_current_time(void) {
+	return 0;
+}
+
+// xorshift, so the positions are the same with any C library
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+// plays random moves from the start until 'plies' moves have been made,
+// returns 0 if the game ends first or the side to move has to pass
+static uint8_t random_position(uint32_t seed, uint8_t plies, BenchPosition* position) {
+	uint8_t left = BOARD_WIDTH / 2 - 1;
+	uint8_t bottom = BOARD_HEIGHT / 2 - 1;
+	BitBoard own = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom + 1));
+	BitBoard opp = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom + 1)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom));
+	random_state = seed;
+	for (uint8_t ply = 0; ply < plies; ply++) {
+		BitBoard moves = bitboard_legal_moves(own, opp);
+		if (moves) {
+			uint8_t choice = next_random() % bitboard_count(moves);
+			uint8_t square = bitboard_pop_lowest(&moves);
+			while (choice--) {
+				square = bitboard_pop_lowest(&moves);
+			}
+			BitBoard flips = bitboard_flips(own, opp, square);
+			own |= flips | BITBOARD_BIT(square);
+			opp &= ~flips;
+		} else if (bitboard_legal_moves(opp, own) == 0) {
+			return 0;
+		}
+		BitBoard swap = own;
+		own = opp;
+		opp = swap;
+	}
+	position->own = own;
+	position->opp = opp;
+	return bitboard_legal_moves(own, opp) != 0;
+}
+
+// a position 'plies' into a random game, picking seeds from 'seed' up
+static uint32_t next_position(uint32_t seed, uint8_t plies, BenchPosition* position) {
+	while (!random_position(seed, plies, position)) {
+		seed++;
+	}
+	return seed + 1;
+}
+
+static void run_search(void) {
+	while (!ai_search_step(0xFFFF)) {
+		;
+	}
+}
+
+static int16_t fixed_search(BitBoard own, BitBoard opp, uint8_t depth) {
+	ai_start_search(own, opp, depth);
+	run_search();
+	return ai_best_score();
+}
+
+typedef struct {
+	uint32_t count;
+	double sx, sy, sxx, sxy, syy;
+} Fit;
+
+static void fit_add(Fit* fit, double x, double y) {
+	fit->count++;
+	fit->sx += x;
+	fit->sy += y;
+	fit->sxx += x * x;
+	fit->sxy += x * y;
+	fit->syy += y * y;
+}
+
+// progress on stderr, overwritten in place. The last call ends the line so
+// that what is printed next starts on a new one
+static void show_progress(int done, int total, const char* what) {
+	fprintf(stderr, "\r%d of %d positions %s", done, total, what);
+	if (done == total) {
+		fprintf(stderr, "\n");
+	}
+	fflush(stderr);
+}
+
+static int calibrate(int num_positions, double threshold) {
+	static Fit fits[AI_PROBCUT_NUM_STAGES][NUM_DEPTHS][AI_PROBCUT_NUM_CHECKS];
+	ai_set_level(AI_NUM_LEVELS);
+
+	uint32_t seed = CALIBRATION_SEED;
+	uint8_t max_plies = BOARD_WIDTH * BOARD_HEIGHT - 4 - AI_MAX_DEPTH;
+	for (int i = 0; i < num_positions; i++) {
+		BenchPosition position;
+		random_state = seed;
+		uint8_t plies = 1 + next_random() % max_plies;
+		seed = next_position(seed, plies, &position);
+		int16_t values[AI_MAX_DEPTH + 1];
+		for (uint8_t depth = 1; depth <= AI_MAX_DEPTH; depth++) {
+			values[depth] = fixed_search(position.own, position.opp, depth);
+		}
+		uint8_t stage = AI_PROBCUT_STAGE(bitboard_count(position.own | position.opp));
+		for (uint8_t depth = AI_PROBCUT_MIN_DEPTH; depth <= AI_MAX_DEPTH; depth++) {
+			for (uint8_t check = 0; check < AI_PROBCUT_NUM_CHECKS; check++) {
+				// the checks are 2 plies apart and keep the deep search's
+				// parity, the last 2 plies shallower than it
+				int shallow = depth - 2 * (AI_PROBCUT_NUM_CHECKS - check);
+				if (shallow < 1 || abs(values[shallow]) >= MAX_FIT_VALUE ||
+						abs(values[depth]) >= MAX_FIT_VALUE) {
+					continue;
+				}
+				fit_add(&fits[stage][depth - AI_PROBCUT_MIN_DEPTH][check],
+						values[shallow], values[depth]);
+			}
+		}
+		show_progress(i + 1, num_positions, "searched");
+	}
+	fprintf(stderr, "%-5s %-5s %-7s %7s %7s %7s %7s %5s\n", "stage", "depth",
+			"shallow", "samples", "slope", "offset", "sigma", "r");
+
+	for (uint8_t stage = 0; stage < AI_PROBCUT_NUM_STAGES; stage++) {
+		printf("\t{\t// stage %d\n", stage);
+		for (uint8_t depth = AI_PROBCUT_MIN_DEPTH; depth <= AI_MAX_DEPTH; depth++) {
+			printf("\t\t{ ");
+			for (uint8_t check = 0; check < AI_PROBCUT_NUM_CHECKS; check++) {
+				const Fit* fit = &fits[stage][depth - AI_PROBCUT_MIN_DEPTH][check];
+				int shallow = depth - 2 * (AI_PROBCUT_NUM_CHECKS - check);
+				double n = fit->count;
+				double variance_x = fit->sxx - fit->sx * fit->sx / n;
+				double covariance = fit->sxy - fit->sx * fit->sy / n;
+				double variance_y = fit->syy - fit->sy * fit->sy / n;
+				double slope = 0, offset = 0, sigma = 0, r = 0;
+				uint8_t used = fit->count >= MIN_SAMPLES && variance_x > 0;
+				if (used) {
+					slope = covariance / variance_x;
+					offset = (fit->sy - slope * fit->sx) / n;
+					double residual = variance_y - slope * covariance;
+					sigma = sqrt((residual > 0 ? residual : 0) / (n - 2));
+					r = covariance / sqrt(variance_x * variance_y);
+					// a shallow search which says nothing about the deep one
+					used = slope > 0.25;
+				}
+				if (shallow >= 1) {
+					fprintf(stderr, "%5d %5d %7d %7u %7.3f %7.1f %7.1f %5.2f%s\n",
+							stage, depth, shallow, fit->count, slope, offset, sigma, r,
+							used ? "" : "  not used");
+				}
+				if (used) {
+					printf("{ %d, %ld, %ld, %ld }", shallow, lround(slope * 256),
+							lround(offset), lround(threshold * sigma));
+				} else {
+					printf("{ 0, 0, 0, 0 }");
+				}
+				printf(check + 1 < AI_PROBCUT_NUM_CHECKS ? ", " : " ");
+			}
+			printf("}%s\t// depth %d\n", depth < AI_MAX_DEPTH ? "," : "", depth);
+		}
+		printf("\t}%s\n", stage + 1 < AI_PROBCUT_NUM_STAGES ? "," : "");
+	}
+	return 0;
+}
+
+static int test(void) {
+	BenchPosition positions[NUM_TEST_POSITIONS];
+	uint32_t seed = TEST_SEED;
+	uint8_t max_plies = BOARD_WIDTH * BOARD_HEIGHT - 4 - AI_MAX_DEPTH;
+	for (int i = 0; i < NUM_TEST_POSITIONS; i++) {
+		// spread through the game
+		uint8_t plies = 2 + i * (max_plies - 2) / NUM_TEST_POSITIONS;
+		seed = next_position(seed, plies, &positions[i]);
+	}
+
+	// each position's moves scored by a full width AI_MAX_DEPTH search
+	ai_set_level(AI_NUM_LEVELS);
+	static int16_t move_values[NUM_TEST_POSITIONS][64];
+	uint8_t best_moves[NUM_TEST_POSITIONS];
+	for (int i = 0; i < NUM_TEST_POSITIONS; i++) {
+		const BenchPosition* position = &positions[i];
+		ai_start_search(position->own, position->opp, AI_MAX_DEPTH);
+		run_search();
+		best_moves[i] = ai_best_move();
+		BitBoard moves = bitboard_legal_moves(position->own, position->opp);
+		while (moves) {
+			uint8_t square = bitboard_pop_lowest(&moves);
+			BitBoard flips = bitboard_flips(position->own, position->opp, square);
+			move_values[i][square] = -fixed_search(position->opp & ~flips,
+					position->own | flips | BITBOARD_BIT(square), AI_MAX_DEPTH - 1);
+		}
+		show_progress(i + 1, NUM_TEST_POSITIONS, "scored");
+	}
+
+	printf("%dx%d board, %d positions, level %d\n", BOARD_WIDTH, BOARD_HEIGHT,
+			NUM_TEST_POSITIONS, AI_NUM_LEVELS);
+	printf("%-12s %10s %11s %12s %10s\n", "", "depth", "nodes/move",
+			"best moves", "value lost");
+	// mean depth and value lost, full width then ProbCut
+	double mean_depth[2], mean_lost[2];
+	for (uint8_t probcut = 0; probcut <= 1; probcut++) {
+		ai_allow_probcut(probcut);
+		uint32_t depths = 0, nodes = 0, agreed = 0;
+		int32_t lost = 0;
+		for (int i = 0; i < NUM_TEST_POSITIONS; i++) {
+			const BenchPosition* position = &positions[i];
+			ai_start_level_search(position->own, position->opp);
+			run_search();
+			depths += ai_depth_reached();
+			nodes += ai_nodes_searched();
+			uint8_t move = ai_best_move();
+			agreed += (move == best_moves[i]);
+			lost += move_values[i][best_moves[i]] - move_values[i][move];
+		}
+		printf("%-12s %10.2f %11.0f %9u/%-2d %10.1f\n",
+				probcut ? "ProbCut" : "full width", (double)depths / NUM_TEST_POSITIONS,
+				(double)nodes / NUM_TEST_POSITIONS, agreed, NUM_TEST_POSITIONS,
+				(double)lost / NUM_TEST_POSITIONS);
+		mean_depth[probcut] = (double)depths / NUM_TEST_POSITIONS;
+		mean_lost[probcut] = (double)lost / NUM_TEST_POSITIONS;
+	}
+	// the extra depth isn't free: the cuts sometimes throw away the best
+	// move, so say what it costs as well as what it gains
+	printf("ProbCut searches %+.2f plies deeper, value lost goes from %.1f to %.1f\n",
+			mean_depth[1] - mean_depth[0], mean_lost[0], mean_lost[1]);
+	ai_allow_probcut(1);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+		int num_positions = DEFAULT_CALIBRATION_POSITIONS;
+		double threshold = DEFAULT_THRESHOLD;
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+				threshold = atof(argv[++i]);
+			} else {
+				num_positions = atoi(argv[i]);
+			}
+		}
+		return calibrate(num_positions, threshold);
+	}
+	return test();
+}
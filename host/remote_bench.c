@@ -0,0 +1,83 @@
+/*
+ * remote_bench.c
+ *
+ * Measures how many remote commands per second the device handles, sending
+ * one command per frame and then several per frame.
+ *
+ * Build and run on the host:
+ *		gcc -O2 -o remote_bench remote_bench.c remote_client.c
+ *		./remote_bench /dev/ttyUSB0 19200 [new baud]
+ *
+ * If a new baud rate is given the device is switched to it first and its
+ * throughput self test is run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "remote_client.h"
+
+#define FRAMES 200
+
+static double now_seconds(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// send FRAMES frames of 'batch' score queries, returns commands per second
+static double run(RemoteClient* client, int batch) {
+	uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+	uint8_t reply_length;
+	double start = now_seconds();
+	for (int i = 0; i < FRAMES; i++) {
+		remote_client_begin(client);
+		for (int j = 0; j < batch; j++) {
+			remote_client_add_scores(client);
+		}
+		if (remote_client_send(client, reply, &reply_length, 1000) < 0) {
+			fprintf(stderr, "no reply to frame %d\n", i);
+			return 0;
+		}
+	}
+	return FRAMES * batch / (now_seconds() - start);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s port [baud]\n", argv[0]);
+		return 1;
+	}
+	long baud = argc > 2 ? atol(argv[2]) : 19200;
+	RemoteClient client;
+	if (remote_client_open(&client, argv[1], baud) < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (argc > 3) {
+		long new_baud = atol(argv[3]);
+		if (remote_client_set_baud(&client, new_baud) < 0) {
+			fprintf(stderr, "device refused %ld baud\n", new_baud);
+			return 1;
+		}
+		uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+		uint8_t reply_length;
+		remote_client_begin(&client);
+		remote_client_add_self_test(&client);
+		if (remote_client_send(&client, reply, &reply_length, 2000) == 0 &&
+				reply_length >= 10) {
+			uint32_t rate = reply[2] | reply[3] << 8 | reply[4] << 16 | (uint32_t)reply[5] << 24;
+			printf("%ld baud: %u bytes/s, UART ISR %.1f%% of CPU, %u ns/byte\n",
+					new_baud, rate, (reply[6] | reply[7] << 8) / 10.0,
+					reply[8] | reply[9] << 8);
+		}
+	}
+	int batches[] = {1, 4, 10};
+	for (int i = 0; i < 3; i++) {
+		printf("%2d commands per frame: %8.1f commands/s\n", batches[i],
+				run(&client, batches[i]));
+	}
+	remote_client_close(&client);
+	return 0;
+}
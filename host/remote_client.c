@@ -0,0 +1,318 @@
+/*
+ * remote_client.c
+ *
+ * Host side client for the remote control protocol. See remote_client.h.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "remote_client.h"
+
+// must match serial_crc16_update() in serialio.c
+static uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+	crc ^= (uint16_t)byte << 8;
+	for (int i = 0; i < 8; i++) {
+		if (crc & 0x8000) {
+			crc = (crc << 1) ^ 0x1021;
+		} else {
+			crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+static speed_t baud_to_speed(long baud) {
+	switch (baud) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 500000: return B500000;
+		case 1000000: return B1000000;
+		default: return B0;	// not a rate the host can set
+	}
+}
+
+static long now_ms(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+int remote_client_open(RemoteClient* client, const char* path, long baud) {
+	if (baud_to_speed(baud) == B0) {
+		return -1;
+	}
+	client->fd = open(path, O_RDWR | O_NOCTTY);
+	if (client->fd < 0) {
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(client->fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, baud_to_speed(baud));
+		cfsetospeed(&tio, baud_to_speed(baud));
+		tcsetattr(client->fd, TCSANOW, &tio);
+	}
+	client->sequence = 0;
+	client->request_length = 0;
+	return 0;
+}
+
+void remote_client_close(RemoteClient* client) {
+	if (client->fd >= 0) {
+		close(client->fd);
+		client->fd = -1;
+	}
+}
+
+void remote_client_begin(RemoteClient* client) {
+	client->request_length = 0;
+}
+
+static int add_command(RemoteClient* client, uint8_t command, const uint8_t* args,
+		uint8_t length) {
+	if (client->request_length + 1 + length > SERIAL_FRAME_MAX_PAYLOAD) {
+		return -1;
+	}
+	client->request[client->request_length++] = command;
+	memcpy(client->request + client->request_length, args, length);
+	client->request_length += length;
+	return 0;
+}
+
+int remote_client_add_set_position(RemoteClient* client, uint64_t p1, uint64_t p2,
+		uint8_t player) {
+	uint8_t args[17];
+	for (int i = 0; i < 8; i++) {
+		args[i] = (uint8_t)(p1 >> (8 * i));
+		args[8 + i] = (uint8_t)(p2 >> (8 * i));
+	}
+	args[16] = player;
+	return add_command(client, REMOTE_SET_POSITION, args, 17);
+}
+
+int remote_client_add_make_move(RemoteClient* client, uint8_t square) {
+	return add_command(client, REMOTE_MAKE_MOVE, &square, 1);
+}
+
+int remote_client_add_legal_moves(RemoteClient* client) {
+	return add_command(client, REMOTE_LEGAL_MOVES, 0, 0);
+}
+
+int remote_client_add_scores(RemoteClient* client) {
+	return add_command(client, REMOTE_SCORES, 0, 0);
+}
+
+int remote_client_add_analyse(RemoteClient* client, uint8_t depth) {
+	return add_command(client, REMOTE_ANALYSE, &depth, 1);
+}
+
+int remote_client_add_self_test(RemoteClient* client) {
+	return add_command(client, REMOTE_SELF_TEST, 0, 0);
+}
+
+int remote_client_add_position_key(RemoteClient* client) {
+	return add_command(client, REMOTE_POSITION_KEY, 0, 0);
+}
+
+int remote_client_add_set_level(RemoteClient* client, uint8_t level) {
+	return add_command(client, REMOTE_SET_LEVEL, &level, 1);
+}
+
+uint64_t remote_client_bitboard(const uint8_t* data) {
+	uint64_t b = 0;
+	for (int i = 7; i >= 0; i--) {
+		b = (b << 8) | data[i];
+	}
+	return b;
+}
+
+static int write_all(int fd, const uint8_t* data, int length) {
+	while (length > 0) {
+		int written = write(fd, data, length);
+		if (written <= 0) {
+			return -1;
+		}
+		data += written;
+		length -= written;
+	}
+	return 0;
+}
+
+// read one byte, waiting no later than 'deadline'. Returns -1 on timeout
+static int read_byte(int fd, long deadline) {
+	long remaining = deadline - now_ms();
+	if (remaining < 0) {
+		return -1;
+	}
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	if (poll(&pfd, 1, (int)remaining) <= 0) {
+		return -1;
+	}
+	uint8_t byte;
+	if (read(fd, &byte, 1) != 1) {
+		return -1;
+	}
+	return byte;
+}
+
+// receive the next good frame. Anything which isn't part of a frame (e.g.
+// the game's terminal output) is skipped
+static int receive_frame(RemoteClient* client, uint8_t* sequence, uint8_t* payload,
+		uint8_t* length, long deadline) {
+	for (;;) {
+		int byte;
+		do {
+			byte = read_byte(client->fd, deadline);
+			if (byte < 0) {
+				return -1;
+			}
+		} while (byte != SERIAL_FRAME_SYNC);
+
+		int seq = read_byte(client->fd, deadline);
+		int len = read_byte(client->fd, deadline);
+		if (seq < 0 || len < 0) {
+			return -1;
+		}
+		if (len > SERIAL_FRAME_MAX_PAYLOAD) {
+			continue;
+		}
+		uint16_t crc = crc16_update(crc16_update(SERIAL_CRC16_INIT, seq), len);
+		int i;
+		for (i = 0; i < len; i++) {
+			byte = read_byte(client->fd, deadline);
+			if (byte < 0) {
+				return -1;
+			}
+			payload[i] = byte;
+			crc = crc16_update(crc, byte);
+		}
+		int crc_low = read_byte(client->fd, deadline);
+		int crc_high = read_byte(client->fd, deadline);
+		if (crc_low < 0 || crc_high < 0) {
+			return -1;
+		}
+		if (crc_low == (crc & 0xFF) && crc_high == (crc >> 8)) {
+			*sequence = seq;
+			*length = len;
+			return 0;
+		}
+	}
+}
+
+int remote_client_send(RemoteClient* client, uint8_t* reply, uint8_t* reply_length,
+		int timeout_ms) {
+	uint8_t frame[SERIAL_FRAME_MAX_PAYLOAD + 5];
+	uint8_t sequence = ++client->sequence;
+	uint8_t length = client->request_length;
+	uint16_t crc = crc16_update(crc16_update(SERIAL_CRC16_INIT, sequence), length);
+	frame[0] = SERIAL_FRAME_SYNC;
+	frame[1] = sequence;
+	frame[2] = length;
+	for (int i = 0; i < length; i++) {
+		frame[3 + i] = client->request[i];
+		crc = crc16_update(crc, client->request[i]);
+	}
+	frame[3 + length] = crc & 0xFF;
+	frame[4 + length] = crc >> 8;
+	if (write_all(client->fd, frame, length + 5) < 0) {
+		return -1;
+	}
+
+	long deadline = now_ms() + timeout_ms;
+	uint8_t reply_sequence;
+	do {
+		if (receive_frame(client, &reply_sequence, reply, reply_length, deadline) < 0) {
+			return -1;
+		}
+		// skip anything else, e.g. an analysis result or trace data from an
+		// earlier request
+	} while (reply_sequence != sequence || reply[0] == REMOTE_ANALYSIS_RESULT ||
+			reply[0] == REMOTE_TRACE_DATA);
+	return 0;
+}
+
+int remote_client_wait_analysis(RemoteClient* client, uint8_t* square, int timeout_ms) {
+	uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+	uint8_t length;
+	uint8_t sequence;
+	long deadline = now_ms() + timeout_ms;
+	do {
+		if (receive_frame(client, &sequence, reply, &length, deadline) < 0) {
+			return -1;
+		}
+	} while (length < 3 || reply[0] != REMOTE_ANALYSIS_RESULT);
+	*square = reply[2];
+	return 0;
+}
+
+int remote_client_read_trace(RemoteClient* client, RemoteTraceEvent* events, int max,
+		int timeout_ms) {
+	uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+	uint8_t length;
+	uint8_t sequence;
+	remote_client_begin(client);
+	add_command(client, REMOTE_TRACE_DUMP, 0, 0);
+	if (remote_client_send(client, reply, &length, timeout_ms) < 0 ||
+			length < 2 || reply[1] != REMOTE_OK) {
+		return -1;
+	}
+	long deadline = now_ms() + timeout_ms;
+	int total = 0;
+	for (;;) {
+		if (receive_frame(client, &sequence, reply, &length, deadline) < 0) {
+			return -1;
+		}
+		if (sequence != client->sequence || length < 2 || reply[0] != REMOTE_TRACE_DATA) {
+			continue;
+		}
+		int count = reply[1];
+		if (count == 0) {
+			return total;
+		}
+		for (int i = 0; i < count && 2 + (i + 1) * TRACE_RECORD_BYTES <= length; i++) {
+			const uint8_t* record = reply + 2 + i * TRACE_RECORD_BYTES;
+			if (total < max) {
+				events[total].time = record[0] | (record[1] << 8) |
+						((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+				events[total].type = record[4];
+				events[total].arg = record[5];
+			}
+			total++;
+		}
+	}
+}
+
+int remote_client_set_baud(RemoteClient* client, long baud) {
+	uint8_t args[4] = { baud & 0xFF, (baud >> 8) & 0xFF, (baud >> 16) & 0xFF,
+			(baud >> 24) & 0xFF };
+	uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+	uint8_t reply_length;
+	if (baud_to_speed(baud) == B0) {
+		return -1;
+	}
+	remote_client_begin(client);
+	add_command(client, REMOTE_SET_BAUD, args, 4);
+	if (remote_client_send(client, reply, &reply_length, 1000) < 0 ||
+			reply_length < 2 || reply[1] != REMOTE_OK) {
+		return -1;
+	}
+	// the device switches a couple of milliseconds after its reply
+	usleep(5000);
+	struct termios tio;
+	if (tcgetattr(client->fd, &tio) < 0) {
+		return -1;
+	}
+	cfsetispeed(&tio, baud_to_speed(baud));
+	cfsetospeed(&tio, baud_to_speed(baud));
+	return tcsetattr(client->fd, TCSADRAIN, &tio);
+}
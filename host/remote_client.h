@@ -0,0 +1,86 @@
+/*
+ * remote_client.h
+ *
+ * Host side (Linux) client for the remote control protocol in remote.h.
+ * Several commands can be queued and sent in one frame, which is much
+ * faster than sending them one at a time since each frame costs a round
+ * trip over the serial link.
+ *
+ *		RemoteClient client;
+ *		remote_client_open(&client, "/dev/ttyUSB0", 19200);
+ *		remote_client_begin(&client);
+ *		remote_client_add_scores(&client);
+ *		remote_client_add_legal_moves(&client);
+ *		remote_client_send(&client, reply, &reply_length, 1000);
+ *
+ * The path can be a pseudo terminal as well as a real serial port.
+ */
+
+#ifndef REMOTE_CLIENT_H_
+#define REMOTE_CLIENT_H_
+
+#include <stdint.h>
+
+#include "../remote.h"
+#include "../serialio.h"
+#include "../trace.h"
+
+typedef struct {
+	uint32_t time;		// in units of TRACE_TICK_NS (see trace.h)
+	uint8_t type;
+	uint8_t arg;
+} RemoteTraceEvent;
+
+typedef struct {
+	int fd;
+	uint8_t sequence;
+	uint8_t request[SERIAL_FRAME_MAX_PAYLOAD];
+	uint8_t request_length;
+} RemoteClient;
+
+// open the serial port (or pty) at 'path'. Returns 0 on success, -1 on error
+int remote_client_open(RemoteClient* client, const char* path, long baud);
+void remote_client_close(RemoteClient* client);
+
+// start a new frame of commands
+void remote_client_begin(RemoteClient* client);
+
+// add a command to the frame. These return -1 (and add nothing) if the
+// frame is full
+int remote_client_add_set_position(RemoteClient* client, uint64_t p1, uint64_t p2,
+		uint8_t player);
+int remote_client_add_make_move(RemoteClient* client, uint8_t square);
+int remote_client_add_legal_moves(RemoteClient* client);
+int remote_client_add_scores(RemoteClient* client);
+int remote_client_add_analyse(RemoteClient* client, uint8_t depth);
+
+int remote_client_add_self_test(RemoteClient* client);
+int remote_client_add_position_key(RemoteClient* client);
+int remote_client_add_set_level(RemoteClient* client, uint8_t level);
+
+// ask the device to change baud rate and, once it has agreed, change the
+// host side to match. Returns 0 on success, -1 if refused or no reply
+int remote_client_set_baud(RemoteClient* client, long baud);
+
+// send the frame and wait up to timeout_ms for the reply with the same
+// sequence number. The reply payload is copied into 'reply' (which must
+// hold SERIAL_FRAME_MAX_PAYLOAD bytes). Returns 0 on success, -1 on error
+// or timeout
+int remote_client_send(RemoteClient* client, uint8_t* reply, uint8_t* reply_length,
+		int timeout_ms);
+
+// wait for the REMOTE_ANALYSIS_RESULT frame after a REMOTE_ANALYSE command.
+// Returns 0 and sets *square on success, -1 on timeout
+int remote_client_wait_analysis(RemoteClient* client, uint8_t* square, int timeout_ms);
+
+// fetch (and empty) the device's trace ring. Up to 'max' events are
+// stored, oldest first. Returns the number of events the device sent
+// (which may be more than 'max'), or -1 if tracing isn't compiled into the
+// device or there's no reply
+int remote_client_read_trace(RemoteClient* client, RemoteTraceEvent* events, int max,
+		int timeout_ms);
+
+// read the bitboard at the start of 'data' (in the protocol's byte order)
+uint64_t remote_client_bitboard(const uint8_t* data);
+
+#endif /* REMOTE_CLIENT_H_ */
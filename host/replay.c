@@ -0,0 +1,347 @@
+/*
+ * replay.c
+ *
+ * Replays recorded input (button pushes, key presses and joystick
+ * movements) into the whole firmware, main() and play_game() included,
+ * running on the simulated hardware in sim/ (see sim/sim.h). Simulated
+ * time only depends on the inputs, so a capture always ends in the same
+ * board (whose hash is printed), and the traffic and timing numbers printed at the end can be
+ * compared between firmware builds to catch performance regressions.
+ * Build with sim/build.sh:
+ *		sh sim/build.sh replay
+ *		./replay [-x speed] [-e hash] [-t] [-v] capture.txt
+ *
+ *		-x	replays the capture 'speed' times faster: every event time is
+ *			divided by it (anything which depends on how long the player
+ *			took, like the timed game clock, may then turn out differently)
+ *		-e	exits with status 1 unless the final board hash is 'hash' (and
+ *			the serial input buffer never overran)
+ *		-t	draws the LED matrix and seven segment display at the end
+ *		-v	prints each event, with the board hash just before it
+ *
+ * A capture is a text file with one event per line, in time order:
+ *		<ms> button <0-2>		push (and release) a push button
+ *		<ms> key <char>			a character arrives on the serial port,
+ *		<ms> key 0x<hex>		given as itself or in hex
+ *		<ms> text <string>		each character of the rest of the line
+ *		<ms> joystick <x> <y>	the joystick ADC readings (0 to 1023, 512
+ *								is centred) from now on
+ *		<ms> end				stop here (otherwise 2s after the last event)
+ * where <ms> is the time since reset in milliseconds. Blank lines and lines
+ * starting with # are ignored. trace_dump -c turns a trace from the board
+ * into a capture.
+ */
+
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim/sim.h"
+#include "../board.h"
+#include "../game.h"
+#include "../sram.h"
+#include "../serialio.h"
+
+#define MAX_EVENTS 4096
+#define MAX_TEXT 64
+// how long a button is held down for
+#define BUTTON_HOLD_MS 20
+// how long to carry on after the last event when there is no "end"
+#define END_DELAY_MS 2000
+
+#define EVENT_BUTTON 0
+#define EVENT_KEYS 1
+#define EVENT_JOYSTICK 2
+#define EVENT_END 3
+
+typedef struct {
+	uint64_t time_ns;
+	uint8_t type;
+	uint8_t length;			// of text
+	uint16_t x, y;			// joystick, or button number in x
+	char text[MAX_TEXT];
+} Event;
+
+static Event events[MAX_EVENTS];
+static int num_events;
+static int next_event;
+static uint64_t end_ns;
+static uint64_t release_ns;
+static uint8_t verbose;
+static jmp_buf finished;
+
+// input to display latency: from an event until the LED matrix is next
+// sent anything
+static uint64_t latency_start_ns;
+static uint32_t latency_start_bytes;
+static uint8_t latency_waiting;
+static uint64_t latency_total_ns;
+static uint64_t latency_max_ns;
+static uint32_t latency_count;
+
+int firmware_main(void);
+
+// The firmware's waiting loops all call button_pushed(), but it only reads
+// a variable, so nothing would move the simulated clock on in a loop which
+// doesn't also read the clock (e.g. the game over screen). The linker
+// (--wrap) sends the calls here instead, which lets time pass as each
+// call would on the board
+int8_t __real_button_pushed(void);
+int8_t __wrap_button_pushed(void) {
+	sim_advance(SIM_POLL_NS);
+	return __real_button_pushed();
+}
+
+// sram.c needs the AVR linker's symbols
+void sram_end_phase(uint8_t phase) {
+	(void)phase;
+}
+
+void sram_report(uint8_t y) {
+	(void)y;
+}
+
+static void fail(int line, const char* message) {
+	fprintf(stderr, "line %d: %s\n", line, message);
+	exit(1);
+}
+
+static void read_capture(const char* path, double speed) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		perror(path);
+		exit(1);
+	}
+	char line[256];
+	int line_number = 0;
+	double last_ms = 0;
+	end_ns = 0;
+	while (fgets(line, sizeof(line), file)) {
+		line_number++;
+		line[strcspn(line, "\r\n")] = '\0';
+		char* p = line + strspn(line, " \t");
+		if (*p == '\0' || *p == '#') {
+			continue;
+		}
+		double ms;
+		char type[16];
+		int used;
+		if (sscanf(p, "%lf %15s %n", &ms, type, &used) < 2) {
+			fail(line_number, "expected <ms> <event>");
+		}
+		if (ms < last_ms) {
+			fail(line_number, "events must be in time order");
+		}
+		last_ms = ms;
+		if (num_events == MAX_EVENTS) {
+			fail(line_number, "too many events");
+		}
+		char* args = p + used;
+		Event* event = &events[num_events];
+		memset(event, 0, sizeof(*event));
+		event->time_ns = (uint64_t)(ms / speed * 1e6);
+		if (strcmp(type, "button") == 0) {
+			event->type = EVENT_BUTTON;
+			event->x = atoi(args);
+			if (event->x > 2) {
+				fail(line_number, "buttons are 0 to 2");
+			}
+		} else if (strcmp(type, "key") == 0) {
+			event->type = EVENT_KEYS;
+			event->length = 1;
+			if (strncmp(args, "0x", 2) == 0 && args[2] != '\0') {
+				event->text[0] = (char)strtoul(args, NULL, 16);
+			} else if (args[0] != '\0') {
+				event->text[0] = args[0];
+			} else {
+				event->text[0] = ' ';
+			}
+		} else if (strcmp(type, "text") == 0) {
+			event->type = EVENT_KEYS;
+			event->length = strlen(args) < MAX_TEXT ? strlen(args) : MAX_TEXT;
+			memcpy(event->text, args, event->length);
+		} else if (strcmp(type, "joystick") == 0) {
+			int x, y;
+			if (sscanf(args, "%d %d", &x, &y) != 2 || x < 0 || x > 1023 ||
+					y < 0 || y > 1023) {
+				fail(line_number, "expected joystick <x> <y>, 0 to 1023");
+			}
+			event->type = EVENT_JOYSTICK;
+			event->x = x;
+			event->y = y;
+		} else if (strcmp(type, "end") == 0) {
+			event->type = EVENT_END;
+			end_ns = event->time_ns;
+			num_events++;
+			break;
+		} else {
+			fail(line_number, "unknown event");
+		}
+		num_events++;
+	}
+	fclose(file);
+	if (end_ns == 0) {
+		end_ns = (uint64_t)(last_ms / speed * 1e6) + END_DELAY_MS * 1000000ULL;
+	}
+}
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+// FNV-1a hash of the board and the player to move
+static uint32_t board_hash(void) {
+	uint32_t hash = FNV_OFFSET;
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			hash = (hash ^ get_piece_at(x, y)) * FNV_PRIME;
+		}
+	}
+	return (hash ^ get_current_player()) * FNV_PRIME;
+}
+
+// and of the LED matrix. This also depends on when the cursor last
+// flashed, so can change with the display timing while the board doesn't
+static uint32_t display_hash(void) {
+	uint32_t hash = FNV_OFFSET;
+	for (uint8_t x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+		for (uint8_t y = 0; y < SIM_MATRIX_ROWS; y++) {
+			hash = (hash ^ sim_matrix[x][y]) * FNV_PRIME;
+		}
+	}
+	return hash;
+}
+
+static void print_event(const Event* event) {
+	fprintf(stderr, "%10.3f ms  board %08x  ", event->time_ns / 1e6, board_hash());
+	switch (event->type) {
+		case EVENT_BUTTON:
+			fprintf(stderr, "button %d\n", event->x);
+			break;
+		case EVENT_KEYS:
+			fprintf(stderr, "key \"%.*s\"\n", event->length, event->text);
+			break;
+		case EVENT_JOYSTICK:
+			fprintf(stderr, "joystick %d %d\n", event->x, event->y);
+			break;
+		case EVENT_END:
+			fprintf(stderr, "end\n");
+			break;
+	}
+}
+
+static void deliver(const Event* event, uint64_t now_ns) {
+	if (verbose) {
+		print_event(event);
+	}
+	switch (event->type) {
+		case EVENT_BUTTON:
+			sim_set_buttons(1 << event->x);
+			release_ns = now_ns + BUTTON_HOLD_MS * 1000000ULL;
+			break;
+		case EVENT_KEYS:
+			sim_uart_receive((const uint8_t*)event->text, event->length);
+			break;
+		case EVENT_JOYSTICK:
+			sim_set_joystick(event->x, event->y);
+			break;
+	}
+	if (event->type != EVENT_END && !latency_waiting) {
+		latency_waiting = 1;
+		latency_start_ns = now_ns;
+		latency_start_bytes = sim_led_bytes_sent();
+	}
+}
+
+// called as the simulated clock moves on
+static void time_hook(uint64_t now_ns) {
+	if (latency_waiting && sim_led_bytes_sent() != latency_start_bytes) {
+		uint64_t latency = now_ns - latency_start_ns;
+		latency_total_ns += latency;
+		if (latency > latency_max_ns) {
+			latency_max_ns = latency;
+		}
+		latency_count++;
+		latency_waiting = 0;
+	}
+	if (release_ns && now_ns >= release_ns) {
+		release_ns = 0;
+		sim_set_buttons(0);
+	}
+	while (next_event < num_events && events[next_event].time_ns <= now_ns) {
+		deliver(&events[next_event++], now_ns);
+	}
+	if (now_ns >= end_ns) {
+		longjmp(finished, 1);
+	}
+}
+
+static double cpu_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+	double speed = 1;
+	const char* expected = NULL;
+	uint8_t render = 0;
+	int option;
+	while ((option = getopt(argc, argv, "x:e:tv")) != -1) {
+		switch (option) {
+			case 'x': speed = atof(optarg); break;
+			case 'e': expected = optarg; break;
+			case 't': render = 1; break;
+			case 'v': verbose = 1; break;
+			default:
+				optind = argc;
+		}
+	}
+	if (optind != argc - 1 || speed <= 0) {
+		fprintf(stderr, "usage: %s [-x speed] [-e hash] [-t] [-v] capture.txt\n", argv[0]);
+		return 1;
+	}
+	read_capture(argv[optind], speed);
+
+	double start = cpu_seconds();
+	sim_time_hook = time_hook;
+	if (setjmp(finished) == 0) {
+		firmware_main();
+	}
+	sim_time_hook = NULL;
+	double cpu = cpu_seconds() - start;
+
+	if (render) {
+		sim_render_terminal(stdout);
+	}
+	uint32_t hash = board_hash();
+	SimLedStats stats;
+	sim_led_stats(&stats);
+	printf("events:     %d of %d replayed\n", next_event, num_events);
+	printf("simulated:  %.3f s, in %.3f s of host CPU\n", sim_time_ns() / 1e9, cpu);
+	printf("led matrix: %u bytes, %.3f ms of SPI\n", sim_led_bytes_sent(),
+			stats.spi_ns / 1e6);
+	uint8_t overrun = serial_input_overrun();
+	printf("serial:     %u bytes sent, input %s\n", sim_uart_bytes_sent(),
+			overrun ? "OVERRUN" : "never overran");
+	if (latency_count) {
+		printf("latency:    %.3f ms mean, %.3f ms max (input to LED matrix, %u inputs)\n",
+				latency_total_ns / 1e6 / latency_count, latency_max_ns / 1e6,
+				latency_count);
+	}
+	printf("board:      %08x  player %d to move%s\n", hash, get_current_player(),
+			is_game_over() ? ", game over" : "");
+	printf("display:    %08x\n", display_hash());
+	if (expected && strtoul(expected, NULL, 16) != hash) {
+		fprintf(stderr, "final board %08x, expected %s\n", hash, expected);
+		return 1;
+	}
+	if (expected && overrun) {
+		fprintf(stderr, "serial input was thrown away\n");
+		return 1;
+	}
+	return 0;
+}
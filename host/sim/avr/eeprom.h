@@ -0,0 +1,18 @@
+/*
+ * avr/eeprom.h (host simulation)
+ *
+ * Reads and writes sim_eeprom[] (see sim.h).
+ */
+
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <stdint.h>
+
+#define EEMEM
+
+uint8_t eeprom_read_byte(const uint8_t* address);
+void eeprom_write_byte(uint8_t* address, uint8_t value);
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+
+#endif /* SIM_AVR_EEPROM_H_ */
@@ -0,0 +1,17 @@
+/*
+ * avr/interrupt.h (host simulation)
+ *
+ * An interrupt handler is an ordinary function, called by sim_hw.c when
+ * the interrupt would have happened.
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#define ISR(vector, ...) void vector(void)
+#define ISR_NOBLOCK
+
+void cli(void);
+void sei(void);
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
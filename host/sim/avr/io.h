@@ -0,0 +1,61 @@
+/*
+ * avr/io.h (host simulation)
+ *
+ * The ATmega324A registers the firmware uses, as plain variables in
+ * sim_hw.c. Registers whose access has a side effect on real hardware
+ * (starting an ADC conversion, a pending interrupt being taken when SREG
+ * is read) go through a function, see sim.h.
+ */
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+#define SIM_REG8(name) extern volatile uint8_t name;
+#define SIM_REG16(name) extern volatile uint16_t name;
+
+SIM_REG8(PORTA) SIM_REG8(PORTB) SIM_REG8(PORTC) SIM_REG8(PORTD)
+SIM_REG8(DDRA) SIM_REG8(DDRB) SIM_REG8(DDRC) SIM_REG8(DDRD)
+SIM_REG8(PINA) SIM_REG8(PINB) SIM_REG8(PINC) SIM_REG8(PIND)
+SIM_REG8(SPCR0) SIM_REG8(SPSR0) SIM_REG8(SPDR0)
+SIM_REG8(UCSR0A) SIM_REG8(UCSR0C) SIM_REG8(UDR0) SIM_REG16(UBRR0)
+SIM_REG8(TCNT0) SIM_REG8(OCR0A) SIM_REG8(TCCR0A) SIM_REG8(TCCR0B)
+SIM_REG8(TIMSK0) SIM_REG8(TIFR0)
+SIM_REG8(PCICR) SIM_REG8(PCIFR) SIM_REG8(PCMSK1)
+SIM_REG8(ADMUX) SIM_REG16(ADC)
+SIM_REG16(TCNT1) SIM_REG8(TCCR1A) SIM_REG8(TCCR1B) SIM_REG8(TIMSK1)
+SIM_REG8(TIFR1) SIM_REG16(OCR1A)
+SIM_REG8(EEDR) SIM_REG16(EEAR)
+SIM_REG8(SPL) SIM_REG8(SPH) SIM_REG16(SP) SIM_REG8(MCUSR)
+
+// registers with side effects
+volatile uint8_t* sim_sreg(void);
+volatile uint8_t* sim_adcsra(void);
+volatile uint8_t* sim_eecr(void);
+volatile uint8_t* sim_ucsr0b(void);
+#define SREG (*sim_sreg())
+#define ADCSRA (*sim_adcsra())
+#define EECR (*sim_eecr())
+#define UCSR0B (*sim_ucsr0b())
+
+enum { PINA0, PINA1, PINA2, PINA3, PINA4, PINA5, PINA6, PINA7 };
+enum { PINC0, PINC1, PINC2, PINC3, PINC4, PINC5, PINC6, PINC7 };
+enum { SREG_I = 7 };
+enum { RXEN0 = 4, TXEN0 = 3, RXCIE0 = 7, UDRIE0 = 5, TXCIE0 = 6, U2X0 = 1,
+		UDRE0 = 5, RXC0 = 7, TXC0 = 6, FE0 = 4, DOR0 = 3, UPE0 = 2 };
+enum { SPE0 = 6, MSTR0 = 4, SPR00 = 0, SPR10 = 1, SPI2X0 = 0, SPIF0 = 7, WCOL0 = 6 };
+enum { WGM01 = 1, CS00 = 0, CS01 = 1, CS02 = 2, OCIE0A = 1, OCF0A = 1 };
+enum { PCIE1 = 1, PCIF1 = 1, PCINT8 = 0, PCINT9 = 1, PCINT10 = 2 };
+enum { REFS0 = 6, ADEN = 7, ADSC = 6, ADPS2 = 2, ADPS1 = 1, ADPS0 = 0 };
+enum { CS10 = 0, CS11 = 1, CS12 = 2, TOIE1 = 0, TOV1 = 0, WGM12 = 3, OCIE1A = 1 };
+enum { EERE = 0, EEPE = 1, EEMPE = 2, EERIE = 3 };
+
+#define RAMEND 0x08FF
+#define E2END 0x3FF
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(reg, bit) ((reg) & _BV(bit))
+#define bit_is_clear(reg, bit) (!((reg) & _BV(bit)))
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,23 @@
+/*
+ * avr/pgmspace.h (host simulation)
+ *
+ * Program memory is ordinary memory on the host.
+ */
+
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char*
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define printf_P printf
+
+#endif /* SIM_AVR_PGMSPACE_H_ */
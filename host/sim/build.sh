@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# build.sh
+#
+# Builds a host program which runs firmware code on the simulated hardware
+# (see sim.h). The firmware sources are built with the shim avr/ headers
+# here and with sim_stdio.h included first; the simulation and the host
+# program itself are built as ordinary Linux code. Run from host/:
+#		sh sim/build.sh display_sim
+#		sh sim/build.sh replay
+#
+# CFLAGS may add to the compiler flags, e.g. CFLAGS=-DTRACE
+
+set -e
+
+here=$(dirname "$0")
+top=$here/../..
+out=${OUT:-.}
+
+case "$1" in
+display_sim)
+	firmware="game.c display.c ledmatrix.c animation.c history.c rules.c
+			bitboard.c position.c stability.c terminalio.c serialio.c timer0.c save.c"
+	;;
+replay)
+	# the whole firmware, except what replay.c replaces. Its main() is
+	# renamed so that replay.c can call it
+	firmware="project.c game.c display.c ledmatrix.c animation.c history.c
+			rules.c bitboard.c position.c stability.c terminalio.c serialio.c timer0.c
+			save.c buttons.c ai.c moveorder.c remote.c profile.c trace.c"
+	firmware_flags="-Dmain=firmware_main"
+	link_flags="-Wl,--wrap=button_pushed"
+	;;
+*)
+	echo "usage: $0 display_sim|replay" >&2
+	exit 1
+	;;
+esac
+
+CC=${CC:-gcc}
+flags="-std=gnu99 -O2 -Wall -Wno-unused-but-set-variable -Wno-int-to-pointer-cast -I$here $CFLAGS"
+
+objects=
+for source in $firmware; do
+	object=$out/sim_$(basename "$source" .c).o
+	$CC $flags -include "$here/sim_stdio.h" $firmware_flags -c "$top/$source" -o "$object"
+	objects="$objects $object"
+done
+$CC $flags -o "$out/$1" "$here/../$1.c" "$here/sim_hw.c" "$here/sim_spi.c" \
+		"$here/sim_render.c" $objects $link_flags
+rm -f $objects
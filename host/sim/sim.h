@@ -0,0 +1,125 @@
+/*
+ * sim.h
+ *
+ * Runs the firmware on a Linux host, with models of the hardware around
+ * it: the LED matrix on the SPI bus, the seven segment display and turn
+ * LEDs on ports A and C, the UART, the EEPROM, the joystick ADC and the
+ * push buttons. See build.sh for how the firmware is built against these.
+ *
+ * Time is simulated, not real. The clock moves on by a fixed amount each
+ * time the firmware reads SREG (which it does every time it reads the
+ * clock, waits for a button or writes to the UART), by the time each SPI
+ * byte and ADC conversion would take on the board, and by any _delay_ms().
+ * Pending interrupts are taken at the same points, whenever interrupts
+ * are enabled. So a run depends only on its inputs, never on how fast the
+ * host is, and the same inputs always give the same result.
+ *
+ * The UART sends instantly and EEPROM writes finish instantly, since the
+ * firmware has loops which wait for these without reading SREG.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_F_CPU 8000000UL
+
+// simulated time which passes each time SREG is read
+#define SIM_POLL_NS 2000
+// an ADC conversion: 13 ADC clocks at 8MHz / 64
+#define SIM_ADC_NS 104000
+
+////////////////////////////// time ////////////////////////////////////
+
+// simulated time since the start, in nanoseconds
+uint64_t sim_time_ns(void);
+
+// moves the clock on by 'ns' and takes any interrupts which are due (if
+// interrupts are enabled)
+void sim_advance(uint64_t ns);
+
+// Called whenever the clock moves on, with the new time, so that a
+// driver can deliver inputs. May be NULL
+extern void (*sim_time_hook)(uint64_t now_ns);
+
+///////////////////////////// inputs ///////////////////////////////////
+
+// push buttons B0 to B2 (PINB bits 0 to 2): set them down (1) or up (0),
+// raising the pin change interrupt if they changed
+void sim_set_buttons(uint8_t state);
+
+// joystick ADC readings (0 to 1023) for channel 0 (x) and 1 (y). Centred
+// is 512
+void sim_set_joystick(uint16_t x, uint16_t y);
+
+// queues bytes to be received by the UART. They arrive one at a time
+// (at the baud rate the firmware set up)
+void sim_uart_receive(const uint8_t* data, uint16_t length);
+
+// number of bytes queued by sim_uart_receive() not yet received
+uint16_t sim_uart_receive_pending(void);
+
+///////////////////////////// outputs //////////////////////////////////
+
+// Called with each byte sent by the UART. May be NULL, in which case
+// the bytes are just counted
+extern void (*sim_uart_output)(uint8_t byte);
+uint32_t sim_uart_bytes_sent(void);
+
+// the EEPROM contents, erased (0xFF) at the start
+#define SIM_EEPROM_SIZE 1024
+extern uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+
+// LED matrix pixels, [x][y] as in ledmatrix.h
+#define SIM_MATRIX_COLUMNS 16
+#define SIM_MATRIX_ROWS 8
+extern uint8_t sim_matrix[SIM_MATRIX_COLUMNS][SIM_MATRIX_ROWS];
+
+// LED matrix traffic, as counted by sim_led_stats()
+#define SIM_LED_CMD_ALL		0
+#define SIM_LED_CMD_PIXEL	1
+#define SIM_LED_CMD_ROW		2
+#define SIM_LED_CMD_COLUMN	3
+#define SIM_LED_CMD_SHIFT	4
+#define SIM_LED_CMD_CLEAR	5
+#define SIM_LED_CMD_OTHER	6
+#define SIM_LED_NUM_CMDS	7
+typedef struct {
+	uint32_t bytes;
+	uint32_t commands[SIM_LED_NUM_CMDS];
+	uint32_t pixels_changed;	// pixels which ended up a different colour
+	uint64_t spi_ns;			// time spent sending
+} SimLedStats;
+
+// copies the LED matrix traffic since the last call into 'stats' and
+// starts counting again (call once per frame to get per frame numbers)
+void sim_led_stats(SimLedStats* stats);
+
+// bytes sent to the LED matrix since the start (not reset by
+// sim_led_stats())
+uint32_t sim_led_bytes_sent(void);
+
+// name of each SIM_LED_CMD_ value
+const char* sim_led_command_name(uint8_t command);
+
+// the seven segment display (segment bits a to g, dp, as written to
+// PORTC) for the left (1) and right (0) digits, and the turn LEDs
+extern uint8_t sim_seven_seg[2];
+uint8_t sim_turn_led_red(void);
+uint8_t sim_turn_led_green(void);
+
+// the digit (or '-' or ' ') shown by some segment bits, '?' if none
+char sim_seven_seg_char(uint8_t segments);
+
+//////////////////////////// rendering /////////////////////////////////
+
+// draws the LED matrix, seven segment display and turn LEDs on an ANSI
+// terminal (24 bit colour), starting at the cursor
+void sim_render_terminal(FILE* out);
+
+// writes the same as a binary PPM image. Returns 0 on success
+int sim_render_ppm(const char* path);
+
+#endif /* SIM_H_ */
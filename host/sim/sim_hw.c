@@ -0,0 +1,300 @@
+/*
+ * sim_hw.c
+ *
+ * The simulated clock, registers, interrupts and the peripherals other
+ * than the LED matrix (which is in sim_spi.c). See sim.h.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+#define SIM_REG8(name) volatile uint8_t name;
+#define SIM_REG16(name) volatile uint16_t name;
+
+SIM_REG8(PORTA) SIM_REG8(PORTB) SIM_REG8(PORTC) SIM_REG8(PORTD)
+SIM_REG8(DDRA) SIM_REG8(DDRB) SIM_REG8(DDRC) SIM_REG8(DDRD)
+SIM_REG8(PINA) SIM_REG8(PINB) SIM_REG8(PINC) SIM_REG8(PIND)
+SIM_REG8(SPCR0) SIM_REG8(SPSR0) SIM_REG8(SPDR0)
+SIM_REG8(UCSR0A) SIM_REG8(UCSR0C) SIM_REG8(UDR0) SIM_REG16(UBRR0)
+SIM_REG8(TCNT0) SIM_REG8(OCR0A) SIM_REG8(TCCR0A) SIM_REG8(TCCR0B)
+SIM_REG8(TIMSK0) SIM_REG8(TIFR0)
+SIM_REG8(PCICR) SIM_REG8(PCIFR) SIM_REG8(PCMSK1)
+SIM_REG8(ADMUX) SIM_REG16(ADC)
+SIM_REG16(TCNT1) SIM_REG8(TCCR1A) SIM_REG8(TCCR1B) SIM_REG8(TIMSK1)
+SIM_REG8(TIFR1) SIM_REG16(OCR1A)
+SIM_REG8(EEDR) SIM_REG16(EEAR)
+SIM_REG8(SPL) SIM_REG8(SPH) SIM_REG16(SP) SIM_REG8(MCUSR)
+
+static volatile uint8_t sreg;
+static volatile uint8_t adcsra;
+static volatile uint8_t eecr;
+static volatile uint8_t ucsr0b;
+
+// register bits (the same as in avr/io.h, which this file doesn't
+// include so that the register names above aren't macros)
+#define SREG_I	7
+#define ADSC	6
+#define EEPE	1
+#define EEMPE	2
+#define EERIE	3
+#define RXCIE0	7
+#define UDRIE0	5
+#define U2X0	1
+#define OCIE0A	1
+#define PCIE1	1
+
+// interrupt handlers, from whichever firmware files are linked in
+#define SIM_VECTOR(name) extern void name(void) __attribute__((weak));
+SIM_VECTOR(TIMER0_COMPA_vect)
+SIM_VECTOR(PCINT1_vect)
+SIM_VECTOR(USART0_RX_vect)
+SIM_VECTOR(USART0_UDRE_vect)
+SIM_VECTOR(EE_READY_vect)
+
+void (*sim_time_hook)(uint64_t now_ns);
+void (*sim_uart_output)(uint8_t byte);
+uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+uint8_t sim_seven_seg[2];
+
+static uint64_t now_ns;
+static uint64_t next_tick_ns = 1000000;
+static uint8_t in_interrupt;
+static uint8_t in_time_hook;
+static uint16_t joystick[2] = { 512, 512 };
+static uint32_t uart_bytes_sent;
+static uint8_t pin_change_pending;
+
+#define RECEIVE_QUEUE_SIZE 4096
+static uint8_t receive_queue[RECEIVE_QUEUE_SIZE];
+static uint16_t receive_head;
+static uint16_t receive_count;
+static uint64_t next_receive_ns;
+
+// erased EEPROM reads as 0xFF
+__attribute__((constructor)) static void erase_eeprom(void) {
+	memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+}
+
+// runs an interrupt handler the way the hardware would, with interrupts
+// turned off until it returns
+static void run_vector(void (*vector)(void)) {
+	uint8_t saved = sreg;
+	sreg &= ~(1 << SREG_I);
+	in_interrupt = 1;
+	vector();
+	in_interrupt = 0;
+	sreg = saved;
+}
+
+// time for one UART character (10 bits) at the baud rate set up
+static uint64_t uart_byte_ns(void) {
+	uint32_t divisor = (UCSR0A & (1 << U2X0)) ? 8 : 16;
+	return 10ULL * divisor * (UBRR0 + 1) * 1000000000ULL / SIM_F_CPU;
+}
+
+static void finish_eeprom_write(void) {
+	if (eecr & (1 << EEPE)) {
+		sim_eeprom[EEAR % SIM_EEPROM_SIZE] = EEDR;
+		eecr &= ~((1 << EEPE) | (1 << EEMPE));
+	}
+}
+
+// takes every interrupt which is pending
+static void take_interrupts(void) {
+	if (in_interrupt || !(sreg & (1 << SREG_I))) {
+		return;
+	}
+	while (now_ns >= next_tick_ns) {
+		if ((TIMSK0 & (1 << OCIE0A)) && TIMER0_COMPA_vect) {
+			run_vector(TIMER0_COMPA_vect);
+		}
+		next_tick_ns += 1000000;
+	}
+	if (pin_change_pending && (PCICR & (1 << PCIE1)) && PCINT1_vect) {
+		pin_change_pending = 0;
+		run_vector(PCINT1_vect);
+	}
+	while (receive_count > 0 && now_ns >= next_receive_ns &&
+			(ucsr0b & (1 << RXCIE0)) && USART0_RX_vect) {
+		UDR0 = receive_queue[receive_head];
+		receive_head = (receive_head + 1) % RECEIVE_QUEUE_SIZE;
+		receive_count--;
+		run_vector(USART0_RX_vect);
+		next_receive_ns += uart_byte_ns();
+	}
+	// the handler writes a byte to UDR0 each time, or turns itself off
+	while ((ucsr0b & (1 << UDRIE0)) && USART0_UDRE_vect) {
+		run_vector(USART0_UDRE_vect);
+		if (ucsr0b & (1 << UDRIE0)) {
+			uart_bytes_sent++;
+			if (sim_uart_output) {
+				sim_uart_output(UDR0);
+			}
+		}
+	}
+	finish_eeprom_write();
+	while ((eecr & (1 << EERIE)) && EE_READY_vect) {
+		run_vector(EE_READY_vect);
+		finish_eeprom_write();
+	}
+}
+
+// the seven segment display shows whichever digit port A selects
+static void sample_outputs(void) {
+	if (DDRC == 0xFF) {
+		sim_seven_seg[(PORTA >> 2) & 1] = PORTC;
+	}
+}
+
+uint64_t sim_time_ns(void) {
+	return now_ns;
+}
+
+void sim_advance(uint64_t ns) {
+	now_ns += ns;
+	if (sim_time_hook && !in_time_hook && !in_interrupt) {
+		// (the hook may well set inputs which advance the clock again)
+		in_time_hook = 1;
+		sim_time_hook(now_ns);
+		in_time_hook = 0;
+	}
+	sample_outputs();
+	take_interrupts();
+}
+
+//////////////////////// registers with side effects //////////////////////
+
+volatile uint8_t* sim_sreg(void) {
+	sim_advance(SIM_POLL_NS);
+	return &sreg;
+}
+
+volatile uint8_t* sim_adcsra(void) {
+	if (adcsra & (1 << ADSC)) {
+		// a conversion was started, finish it
+		ADC = joystick[ADMUX & 0x01];
+		adcsra &= ~(1 << ADSC);
+		sim_advance(SIM_ADC_NS);
+	}
+	return &adcsra;
+}
+
+volatile uint8_t* sim_eecr(void) {
+	take_interrupts();
+	return &eecr;
+}
+
+volatile uint8_t* sim_ucsr0b(void) {
+	take_interrupts();
+	return &ucsr0b;
+}
+
+void cli(void) {
+	sreg &= ~(1 << SREG_I);
+}
+
+void sei(void) {
+	sreg |= (1 << SREG_I);
+	take_interrupts();
+}
+
+void _delay_ms(double ms) {
+	sim_advance((uint64_t)(ms * 1000000));
+}
+
+void _delay_us(double us) {
+	sim_advance((uint64_t)(us * 1000));
+}
+
+//////////////////////////////// EEPROM //////////////////////////////////
+
+uint8_t eeprom_read_byte(const uint8_t* address) {
+	return sim_eeprom[(uintptr_t)address % SIM_EEPROM_SIZE];
+}
+
+void eeprom_write_byte(uint8_t* address, uint8_t value) {
+	sim_eeprom[(uintptr_t)address % SIM_EEPROM_SIZE] = value;
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value) {
+	eeprom_write_byte(address, value);
+}
+
+//////////////////////////////// inputs //////////////////////////////////
+
+void sim_set_buttons(uint8_t state) {
+	uint8_t old = PINB;
+	PINB = (PINB & ~0x07) | (state & 0x07);
+	if (PCMSK1 & (old ^ PINB)) {
+		pin_change_pending = 1;
+		take_interrupts();
+	}
+}
+
+void sim_set_joystick(uint16_t x, uint16_t y) {
+	joystick[0] = x;
+	joystick[1] = y;
+}
+
+void sim_uart_receive(const uint8_t* data, uint16_t length) {
+	if (receive_count == 0) {
+		next_receive_ns = now_ns + uart_byte_ns();
+	}
+	for (uint16_t i = 0; i < length && receive_count < RECEIVE_QUEUE_SIZE; i++) {
+		receive_queue[(receive_head + receive_count) % RECEIVE_QUEUE_SIZE] = data[i];
+		receive_count++;
+	}
+}
+
+uint16_t sim_uart_receive_pending(void) {
+	return receive_count;
+}
+
+/////////////////////////////// outputs //////////////////////////////////
+
+uint32_t sim_uart_bytes_sent(void) {
+	return uart_bytes_sent;
+}
+
+uint8_t sim_turn_led_red(void) {
+	return (DDRA & (1 << 3)) && (PORTA & (1 << 3));
+}
+
+uint8_t sim_turn_led_green(void) {
+	return (DDRA & (1 << 4)) && (PORTA & (1 << 4));
+}
+
+/////////////////////////////// stdio ////////////////////////////////////
+
+// see sim_stdio.h (this file is built without it)
+typedef struct SimStream {
+	int (*put)(char, struct SimStream*);
+	int (*get)(struct SimStream*);
+	int flags;
+} SimStream;
+
+SimStream* sim_stdin;
+SimStream* sim_stdout;
+
+int sim_printf(const char* format, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (length >= (int)sizeof(text)) {
+		length = sizeof(text) - 1;
+	}
+	for (int i = 0; i < length && sim_stdout; i++) {
+		sim_stdout->put(text[i], sim_stdout);
+	}
+	return length;
+}
+
+int sim_fgetc(SimStream* stream) {
+	return stream->get(stream);
+}
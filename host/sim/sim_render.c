@@ -0,0 +1,125 @@
+/*
+ * sim_render.c
+ *
+ * Draws the simulated LED matrix, seven segment display and turn LEDs,
+ * on a terminal or into an image.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+// the digits as the firmware writes them to PORTC (see seven_seg[] in
+// game.c)
+static const uint8_t digit_segments[10] = {63, 6, 91, 79, 102, 109, 125, 7, 127, 111};
+
+char sim_seven_seg_char(uint8_t segments) {
+	segments &= 0x7F;	// ignore the decimal point
+	for (uint8_t i = 0; i < 10; i++) {
+		if (digit_segments[i] == segments) {
+			return '0' + i;
+		}
+	}
+	if (segments == 0x40) {
+		return '-';
+	}
+	if (segments == 0) {
+		return ' ';
+	}
+	return '?';
+}
+
+// a PixelColour has 4 bits of red (low nibble) and green (high nibble)
+static void pixel_rgb(uint8_t colour, uint8_t* rgb) {
+	rgb[0] = (colour & 0x0F) * 17;
+	rgb[1] = (colour >> 4) * 17;
+	rgb[2] = 0;
+}
+
+void sim_render_terminal(FILE* out) {
+	uint8_t rgb[3];
+	// row 7 is at the top
+	for (int y = SIM_MATRIX_ROWS - 1; y >= 0; y--) {
+		for (int x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+			uint8_t colour = sim_matrix[x][y];
+			if (colour == 0) {
+				fprintf(out, "\x1b[38;2;60;60;60m\xc2\xb7 ");
+			} else {
+				pixel_rgb(colour, rgb);
+				fprintf(out, "\x1b[38;2;%d;%d;%dm\xe2\x97\x8f ", rgb[0], rgb[1], rgb[2]);
+			}
+		}
+		fprintf(out, "\x1b[0m\n");
+	}
+	fprintf(out, "[%c%c]  turn: %s%s\n", sim_seven_seg_char(sim_seven_seg[1]),
+			sim_seven_seg_char(sim_seven_seg[0]),
+			sim_turn_led_red() ? "\x1b[31mred\x1b[0m " : "",
+			sim_turn_led_green() ? "\x1b[32mgreen\x1b[0m" : "");
+}
+
+// image layout: the matrix in PIXEL_SIZE squares, then a strip below it
+// with the two digits and the turn LEDs
+#define PIXEL_SIZE 20
+#define IMAGE_WIDTH (SIM_MATRIX_COLUMNS * PIXEL_SIZE)
+#define MATRIX_HEIGHT (SIM_MATRIX_ROWS * PIXEL_SIZE)
+#define STRIP_HEIGHT 60
+#define IMAGE_HEIGHT (MATRIX_HEIGHT + STRIP_HEIGHT)
+
+static uint8_t image[IMAGE_HEIGHT][IMAGE_WIDTH][3];
+
+static void fill(int x0, int y0, int width, int height, const uint8_t* rgb) {
+	for (int y = y0; y < y0 + height; y++) {
+		for (int x = x0; x < x0 + width; x++) {
+			image[y][x][0] = rgb[0];
+			image[y][x][1] = rgb[1];
+			image[y][x][2] = rgb[2];
+		}
+	}
+}
+
+// one digit of the seven segment display, 20 wide and 40 high
+static void draw_digit(int x0, int y0, uint8_t segments) {
+	static const uint8_t on[3] = {255, 40, 40};
+	static const uint8_t off[3] = {40, 20, 20};
+	// a, b, c, d, e, f, g as x, y, width, height
+	static const uint8_t shapes[7][4] = {
+		{3, 0, 14, 3}, {17, 3, 3, 16}, {17, 21, 3, 16}, {3, 37, 14, 3},
+		{0, 21, 3, 16}, {0, 3, 3, 16}, {3, 18, 14, 3}
+	};
+	for (int s = 0; s < 7; s++) {
+		fill(x0 + shapes[s][0], y0 + shapes[s][1], shapes[s][2], shapes[s][3],
+				(segments & (1 << s)) ? on : off);
+	}
+}
+
+int sim_render_ppm(const char* path) {
+	static const uint8_t background[3] = {20, 20, 20};
+	static const uint8_t red[3] = {255, 0, 0};
+	static const uint8_t green[3] = {0, 255, 0};
+	uint8_t rgb[3];
+	fill(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, background);
+	for (int x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+		for (int y = 0; y < SIM_MATRIX_ROWS; y++) {
+			pixel_rgb(sim_matrix[x][y], rgb);
+			// leave a border round each LED
+			fill(x * PIXEL_SIZE + 2, (SIM_MATRIX_ROWS - 1 - y) * PIXEL_SIZE + 2,
+					PIXEL_SIZE - 4, PIXEL_SIZE - 4, rgb);
+		}
+	}
+	draw_digit(10, MATRIX_HEIGHT + 10, sim_seven_seg[1]);
+	draw_digit(40, MATRIX_HEIGHT + 10, sim_seven_seg[0]);
+	fill(IMAGE_WIDTH - 60, MATRIX_HEIGHT + 20, 20, 20,
+			sim_turn_led_red() ? red : background);
+	fill(IMAGE_WIDTH - 30, MATRIX_HEIGHT + 20, 20, 20,
+			sim_turn_led_green() ? green : background);
+
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		return -1;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", IMAGE_WIDTH, IMAGE_HEIGHT);
+	size_t written = fwrite(image, 1, sizeof(image), file);
+	fclose(file);
+	return written == sizeof(image) ? 0 : -1;
+}
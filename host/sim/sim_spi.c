@@ -0,0 +1,181 @@
+/*
+ * sim_spi.c
+ *
+ * Replaces spi.c. Each byte sent is fed to a model of the LED matrix,
+ * which decodes the command stream (see ledmatrix.c) into sim_matrix[][]
+ * and counts the traffic. The clock moves on by the time the byte takes
+ * at the SPI speed the firmware chose.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sim.h"
+#include "../../spi.h"
+
+#define CMD_UPDATE_ALL 0x00
+#define CMD_UPDATE_PIXEL 0x01
+#define CMD_UPDATE_ROW 0x02
+#define CMD_UPDATE_COL 0x03
+#define CMD_SHIFT_DISPLAY 0x04
+#define CMD_CLEAR_SCREEN 0x0F
+
+uint8_t sim_matrix[SIM_MATRIX_COLUMNS][SIM_MATRIX_ROWS];
+
+static uint8_t clock_divider = 128;
+static uint8_t byte_gap;
+static uint8_t last_byte;
+
+// the command being received, and its data so far
+static uint8_t command;
+static uint8_t in_command;
+static uint8_t data[SIM_MATRIX_COLUMNS * SIM_MATRIX_ROWS + 1];
+static uint8_t data_length;
+
+static SimLedStats stats;
+static uint32_t bytes_sent;
+
+static const char* const command_names[SIM_LED_NUM_CMDS] = {
+	"all", "pixel", "row", "column", "shift", "clear", "other"
+};
+
+void spi_setup_master(uint8_t clockdivider) {
+	switch (clockdivider) {
+		case 2: case 4: case 8: case 16: case 32: case 64:
+			clock_divider = clockdivider;
+			break;
+		default:
+			clock_divider = 128;
+	}
+}
+
+void spi_set_byte_gap(uint8_t microseconds) {
+	byte_gap = microseconds;
+}
+
+// number of data bytes which follow a command
+static uint8_t data_needed(uint8_t cmd) {
+	switch (cmd) {
+		case CMD_UPDATE_ALL:	return SIM_MATRIX_COLUMNS * SIM_MATRIX_ROWS;
+		case CMD_UPDATE_PIXEL:	return 2;
+		case CMD_UPDATE_ROW:	return 1 + SIM_MATRIX_COLUMNS;
+		case CMD_UPDATE_COL:	return 1 + SIM_MATRIX_ROWS;
+		case CMD_SHIFT_DISPLAY:	return 1;
+	}
+	return 0;
+}
+
+static void set_pixel(uint8_t x, uint8_t y, uint8_t colour) {
+	if (sim_matrix[x][y] != colour) {
+		sim_matrix[x][y] = colour;
+		stats.pixels_changed++;
+	}
+}
+
+// shifts the whole display one place, blanking the row or column which
+// comes on
+static void shift(uint8_t direction) {
+	uint8_t old[SIM_MATRIX_COLUMNS][SIM_MATRIX_ROWS];
+	memcpy(old, sim_matrix, sizeof(old));
+	for (uint8_t x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+		for (uint8_t y = 0; y < SIM_MATRIX_ROWS; y++) {
+			int from_x = x;
+			int from_y = y;
+			if (direction & 0x02) {
+				from_x = x + 1;		// left
+			} else if (direction & 0x01) {
+				from_x = x - 1;		// right
+			} else if (direction & 0x08) {
+				from_y = y - 1;		// up
+			} else if (direction & 0x04) {
+				from_y = y + 1;		// down
+			}
+			uint8_t colour = 0;
+			if (from_x >= 0 && from_x < SIM_MATRIX_COLUMNS &&
+					from_y >= 0 && from_y < SIM_MATRIX_ROWS) {
+				colour = old[from_x][from_y];
+			}
+			set_pixel(x, y, colour);
+		}
+	}
+}
+
+static void run_command(void) {
+	switch (command) {
+		case CMD_UPDATE_ALL:
+			stats.commands[SIM_LED_CMD_ALL]++;
+			// sent a row at a time, bottom row first
+			for (uint8_t i = 0; i < data_length; i++) {
+				set_pixel(i % SIM_MATRIX_COLUMNS, i / SIM_MATRIX_COLUMNS, data[i]);
+			}
+			break;
+		case CMD_UPDATE_PIXEL:
+			stats.commands[SIM_LED_CMD_PIXEL]++;
+			set_pixel(data[0] & 0x0F, (data[0] >> 4) & 0x07, data[1]);
+			break;
+		case CMD_UPDATE_ROW:
+			stats.commands[SIM_LED_CMD_ROW]++;
+			for (uint8_t x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+				set_pixel(x, data[0] & 0x07, data[1 + x]);
+			}
+			break;
+		case CMD_UPDATE_COL:
+			stats.commands[SIM_LED_CMD_COLUMN]++;
+			for (uint8_t y = 0; y < SIM_MATRIX_ROWS; y++) {
+				set_pixel(data[0] & 0x0F, y, data[1 + y]);
+			}
+			break;
+		case CMD_SHIFT_DISPLAY:
+			stats.commands[SIM_LED_CMD_SHIFT]++;
+			shift(data[0]);
+			break;
+		case CMD_CLEAR_SCREEN:
+			stats.commands[SIM_LED_CMD_CLEAR]++;
+			for (uint8_t x = 0; x < SIM_MATRIX_COLUMNS; x++) {
+				for (uint8_t y = 0; y < SIM_MATRIX_ROWS; y++) {
+					set_pixel(x, y, 0);
+				}
+			}
+			break;
+		default:
+			stats.commands[SIM_LED_CMD_OTHER]++;
+	}
+}
+
+uint8_t spi_send_byte(uint8_t byte) {
+	uint64_t ns = 8ULL * clock_divider * 1000000000ULL / SIM_F_CPU + byte_gap * 1000ULL;
+	stats.bytes++;
+	bytes_sent++;
+	stats.spi_ns += ns;
+
+	if (!in_command) {
+		command = byte;
+		in_command = 1;
+		data_length = 0;
+	} else {
+		data[data_length++] = byte;
+	}
+	if (data_length == data_needed(command)) {
+		run_command();
+		in_command = 0;
+	}
+
+	sim_advance(ns);
+	// the matrix's data register shifts out the byte it received last
+	uint8_t echo = last_byte;
+	last_byte = byte;
+	return echo;
+}
+
+void sim_led_stats(SimLedStats* stats_out) {
+	*stats_out = stats;
+	memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t sim_led_bytes_sent(void) {
+	return bytes_sent;
+}
+
+const char* sim_led_command_name(uint8_t cmd) {
+	return cmd < SIM_LED_NUM_CMDS ? command_names[cmd] : "?";
+}
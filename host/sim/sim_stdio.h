@@ -0,0 +1,40 @@
+/*
+ * sim_stdio.h
+ *
+ * Included before every firmware source file when building it for the
+ * simulation (gcc -include sim_stdio.h). avr-libc lets serialio.c point
+ * stdin and stdout at its own stream, which glibc doesn't, so the
+ * firmware's FILE, stdin, stdout, printf() and fgetc() are swapped for
+ * versions in sim_hw.c which call the stream's put and get functions.
+ * Everything printed then goes through the simulated UART just as it
+ * would on the board.
+ */
+
+#ifndef SIM_STDIO_H_
+#define SIM_STDIO_H_
+
+#include <stdio.h>
+
+typedef struct SimStream {
+	int (*put)(char, struct SimStream*);
+	int (*get)(struct SimStream*);
+	int flags;
+} SimStream;
+
+extern SimStream* sim_stdin;
+extern SimStream* sim_stdout;
+
+int sim_printf(const char* format, ...);
+int sim_fgetc(SimStream* stream);
+
+#undef stdin
+#undef stdout
+#define FILE SimStream
+#define stdin sim_stdin
+#define stdout sim_stdout
+#define printf sim_printf
+#define fgetc sim_fgetc
+#define FDEV_SETUP_STREAM(put, get, flags) { (put), (get), (flags) }
+#define _FDEV_SETUP_RW 0
+
+#endif /* SIM_STDIO_H_ */
@@ -0,0 +1,13 @@
+/*
+ * util/delay.h (host simulation)
+ *
+ * Delays move the simulated clock on rather than waiting.
+ */
+
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+void _delay_ms(double ms);
+void _delay_us(double us);
+
+#endif /* SIM_UTIL_DELAY_H_ */
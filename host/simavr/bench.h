@@ -0,0 +1,35 @@
+/*
+ * bench.h
+ *
+ * What bench_firmware.c (running on the simulated AVR) and simavr_bench.c
+ * (running it) agree on. The firmware marks the start of each measurement
+ * by writing the benchmark's number to GPIOR0 and the end by writing
+ * BENCH_STOP. The simulator sees each write, so knows the exact cycle
+ * count in between.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+// data space addresses (I/O address + 0x20) of the general purpose I/O
+// registers used: GPIOR0 for the marks, GPIOR1 and GPIOR2 for the low and
+// high bytes of a result
+#define BENCH_MARK_ADDRESS		0x3E
+#define BENCH_RESULT_LOW_ADDRESS	0x4A
+#define BENCH_RESULT_HIGH_ADDRESS	0x4B
+
+#define BENCH_STOP					0
+#define BENCH_OVERHEAD				1	// an empty measurement
+#define BENCH_IS_VALID_POSITION		2
+#define BENCH_PLACE_A_PIECE			3
+#define BENCH_SCORE_IN_TERMINAL		4
+#define BENCH_LED_UPDATE_COLUMN		5
+#define BENCH_UART_PUT_CHAR			6
+#define BENCH_UART_PUT_NEWLINE		7
+#define BENCH_NUM					8
+
+// written to GPIOR0 after the result (GPIOR1/2) has been set to the free
+// stack in bytes, when the benchmarks have all run
+#define BENCH_DONE					0xFF
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# bench.sh
+#
+# Cycle counts of the firmware's hot functions, measured on simavr, and
+# the flash and SRAM the firmware uses, for the build in the working tree.
+# Needs avr-gcc, avr-libc, avr-size and simavr (with its headers and
+# libelf). Run from host/simavr/:
+#		sh bench.sh
+#
+# CFLAGS may add to the firmware's build flags, e.g.
+#		CFLAGS="-DBOARD_WIDTH=10 -DBOARD_HEIGHT=10" sh bench.sh
+# so that builds can be compared. MCU picks the part simavr simulates if
+# it doesn't know the atmega324a (the atmega324p runs the same code in
+# the same number of cycles).
+
+set -e
+
+top=../..
+out=${OUT:-bench_build}
+mcu=${MCU:-atmega324a}
+flags="-mmcu=atmega324a -DF_CPU=8000000UL -std=gnu99 -Os -Wall
+		-ffunction-sections -fdata-sections -I$top $CFLAGS"
+
+# every firmware module, except the one with the real main()
+modules=
+for source in $top/*.c; do
+	[ "$(basename "$source")" = project.c ] || modules="$modules $source"
+done
+
+mkdir -p "$out"
+echo "building the firmware and the benchmarks"
+avr-gcc $flags -Wl,--gc-sections -o "$out/reversi.elf" $modules "$top/project.c"
+avr-gcc $flags -Wl,--gc-sections -o "$out/bench.elf" $modules bench_firmware.c
+gcc -O2 -o "$out/simavr_bench" simavr_bench.c -lsimavr -lelf
+
+echo
+echo "build: $(git describe --always --dirty 2>/dev/null || echo unknown) $CFLAGS"
+avr-size -C --mcu=atmega324a "$out/reversi.elf" | grep -E "Program|Data"
+echo
+"$out/simavr_bench" "$out/bench.elf" "$mcu"
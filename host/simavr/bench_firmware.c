@@ -0,0 +1,193 @@
+/*
+ * bench_firmware.c
+ *
+ * A main() for the firmware which runs its hot functions on fixed inputs
+ * for simavr_bench.c to time (see bench.h and bench.sh). It is linked with
+ * every firmware module except project.c.
+ *
+ * The board is the one reached from the start by always playing the first
+ * legal square (in x then y order) for BENCH_OPENING_MOVES moves, so the
+ * inputs are the same on every build and any board size. Each measurement
+ * runs with interrupts off, after the serial output buffer has been
+ * emptied, so no interrupt handler adds to it.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include "../../board.h"
+#include "../../display.h"
+#include "../../game.h"
+#include "../../ledmatrix.h"
+#include "../../serialio.h"
+#include "../../sram.h"
+#include "../../timer0.h"
+#include "bench.h"
+
+#define BENCH_OPENING_MOVES 12
+// number of times the single character benchmarks are repeated
+#define BENCH_REPEAT 16
+// free space in an empty serial output buffer
+#define SERIAL_BUFFER_SPACE 255
+
+#define BENCH_BEGIN(bench) (GPIOR0 = (bench))
+#define BENCH_END() (GPIOR0 = BENCH_STOP)
+
+// in game.c, but not part of its interface
+uint8_t is_valid_position(uint8_t px, uint8_t py);
+
+// results are written here so the calls being measured aren't optimised
+// away
+static volatile uint8_t sink;
+
+// where the game.c cursor is, so it can be moved to a square
+static uint8_t cursor_x, cursor_y;
+
+static void cursor_to(uint8_t x, uint8_t y) {
+	move_display_cursor(x - cursor_x, y - cursor_y);
+	cursor_x = x;
+	cursor_y = y;
+}
+
+// sends anything waiting to go out of the serial port, then turns
+// interrupts off for a measurement
+static void quiet(void) {
+	sei();
+	while (serial_output_space() < SERIAL_BUFFER_SPACE) {
+		;
+	}
+	cli();
+}
+
+static uint8_t first_legal_move(uint8_t* x_out, uint8_t* y_out) {
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if (is_legal_move(x, y)) {
+				*x_out = x;
+				*y_out = y;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static void play_opening(void) {
+	uint8_t x, y;
+	for (uint8_t i = 0; i < BENCH_OPENING_MOVES && first_legal_move(&x, &y); i++) {
+		place_piece_at(x, y);
+		cursor_x = x;
+		cursor_y = y;
+	}
+	quiet();
+}
+
+static void bench_overhead(void) {
+	for (uint8_t i = 0; i < BENCH_REPEAT; i++) {
+		BENCH_BEGIN(BENCH_OVERHEAD);
+		BENCH_END();
+	}
+}
+
+// every square, legal or not
+static void bench_is_valid_position(void) {
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			BENCH_BEGIN(BENCH_IS_VALID_POSITION);
+			sink = is_valid_position(x, y);
+			BENCH_END();
+		}
+	}
+}
+
+// every legal square, each taken back again before the next
+static void bench_place_a_piece(void) {
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if (!is_legal_move(x, y)) {
+				continue;
+			}
+			cursor_to(x, y);
+			quiet();
+			BENCH_BEGIN(BENCH_PLACE_A_PIECE);
+			place_a_piece();
+			BENCH_END();
+			undo_move();
+		}
+	}
+	quiet();
+}
+
+static void bench_score_in_terminal(void) {
+	for (uint8_t i = 0; i < BENCH_REPEAT; i++) {
+		quiet();
+		BENCH_BEGIN(BENCH_SCORE_IN_TERMINAL);
+		score_in_terminal();
+		BENCH_END();
+	}
+	quiet();
+}
+
+static void bench_led_update_column(void) {
+	MatrixColumn column;
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+			column[y] = (x + y) & 1 ? COLOUR_RED : COLOUR_GREEN;
+		}
+		BENCH_BEGIN(BENCH_LED_UPDATE_COLUMN);
+		ledmatrix_update_column(x, column);
+		BENCH_END();
+	}
+}
+
+// uart_put_char() is reached through stdout, as printf() reaches it. A
+// newline sends "\r\n"
+static void bench_uart_put_char(void) {
+	for (uint8_t i = 0; i < BENCH_REPEAT; i++) {
+		BENCH_BEGIN(BENCH_UART_PUT_CHAR);
+		fputc('x', stdout);
+		BENCH_END();
+	}
+	quiet();
+	for (uint8_t i = 0; i < BENCH_REPEAT; i++) {
+		BENCH_BEGIN(BENCH_UART_PUT_NEWLINE);
+		fputc('\n', stdout);
+		BENCH_END();
+	}
+	quiet();
+}
+
+int main(void) {
+	ledmatrix_setup();
+	init_serial_stdio(19200, 0);
+	init_timer0();
+	sei();
+
+	initialise_board();
+	cursor_x = BOARD_WIDTH / 2 + 1;		// CURSOR_X_START in game.c
+	cursor_y = BOARD_HEIGHT / 2 - 1;
+	play_opening();
+
+	bench_overhead();
+	bench_is_valid_position();
+	bench_place_a_piece();
+	bench_score_in_terminal();
+	bench_led_update_column();
+	bench_uart_put_char();
+
+	uint16_t stack_free = sram_stack_free();
+	GPIOR1 = stack_free & 0xFF;
+	GPIOR2 = stack_free >> 8;
+	GPIOR0 = BENCH_DONE;
+
+	// simavr stops when the CPU sleeps with interrupts off
+	cli();
+	sleep_mode();
+	while (1) {
+		;
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ * simavr_bench.c
+ *
+ * Runs bench_firmware.c on simavr and prints the exact cycle count of
+ * each benchmark (see bench.h). The count for a call is the number of
+ * cycles between the firmware's start and stop marks, less the cycles an
+ * empty measurement takes. Built and run by bench.sh, or by hand:
+ *		gcc -O2 -o simavr_bench simavr_bench.c -lsimavr -lelf
+ *		./simavr_bench bench.elf [mcu]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+
+#include "bench.h"
+
+#define F_CPU 8000000UL
+// give up if the firmware hasn't finished after this many cycles (a
+// minute on the board)
+#define CYCLE_LIMIT (60ULL * F_CPU)
+
+typedef struct {
+	uint64_t min;
+	uint64_t max;
+	uint64_t total;
+	uint32_t count;
+} BenchResult;
+
+static const char* const bench_names[BENCH_NUM] = {
+	"",
+	"(empty measurement)",
+	"is_valid_position",
+	"place_a_piece",
+	"score_in_terminal",
+	"ledmatrix_update_column",
+	"uart_put_char",
+	"uart_put_char('\\n')"
+};
+
+static BenchResult results[BENCH_NUM];
+static uint8_t running;				// benchmark being measured, or BENCH_STOP
+static avr_cycle_count_t start_cycle;
+static uint8_t done;
+static uint16_t stack_free;
+
+static void mark_written(avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+	(void)address;
+	(void)param;
+	if (value == BENCH_DONE) {
+		stack_free = ((uint16_t)avr->data[BENCH_RESULT_HIGH_ADDRESS] << 8) |
+				avr->data[BENCH_RESULT_LOW_ADDRESS];
+		done = 1;
+	} else if (value == BENCH_STOP) {
+		if (running != BENCH_STOP) {
+			BenchResult* result = &results[running];
+			uint64_t cycles = avr->cycle - start_cycle;
+			if (result->count == 0 || cycles < result->min) {
+				result->min = cycles;
+			}
+			if (cycles > result->max) {
+				result->max = cycles;
+			}
+			result->total += cycles;
+			result->count++;
+			running = BENCH_STOP;
+		}
+	} else if (value < BENCH_NUM) {
+		running = value;
+		start_cycle = avr->cycle;
+	}
+}
+
+// (registering a write handler stops simavr storing the value itself)
+static void result_written(avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+	(void)param;
+	avr->data[address] = value;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s bench.elf [mcu]\n", argv[0]);
+		return 1;
+	}
+	const char* mcu = argc > 2 ? argv[2] : "atmega324a";
+
+	elf_firmware_t firmware = {{0}};
+	if (elf_read_firmware(argv[1], &firmware) != 0) {
+		fprintf(stderr, "can't read %s\n", argv[1]);
+		return 1;
+	}
+	avr_t* avr = avr_make_mcu_by_name(mcu);
+	if (!avr) {
+		fprintf(stderr, "simavr doesn't know the %s\n", mcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr->frequency = F_CPU;
+	avr_load_firmware(avr, &firmware);
+	avr_register_io_write(avr, BENCH_MARK_ADDRESS, mark_written, NULL);
+	avr_register_io_write(avr, BENCH_RESULT_LOW_ADDRESS, result_written, NULL);
+	avr_register_io_write(avr, BENCH_RESULT_HIGH_ADDRESS, result_written, NULL);
+
+	int state = cpu_Running;
+	while (!done && state != cpu_Done && state != cpu_Crashed &&
+			avr->cycle < CYCLE_LIMIT) {
+		state = avr_run(avr);
+	}
+	if (!done) {
+		fprintf(stderr, "the benchmarks didn't finish (%s after %llu cycles)\n",
+				state == cpu_Crashed ? "crashed" : "stopped",
+				(unsigned long long)avr->cycle);
+		return 1;
+	}
+
+	uint64_t overhead = results[BENCH_OVERHEAD].count ? results[BENCH_OVERHEAD].min : 0;
+	printf("%-24s %6s %8s %8s %8s\n", "function", "calls", "min", "mean", "max");
+	for (uint8_t i = BENCH_OVERHEAD + 1; i < BENCH_NUM; i++) {
+		const BenchResult* result = &results[i];
+		if (result->count == 0) {
+			printf("%-24s %6s\n", bench_names[i], "-");
+			continue;
+		}
+		printf("%-24s %6u %8llu %8.1f %8llu\n", bench_names[i], result->count,
+				(unsigned long long)(result->min - overhead),
+				(double)result->total / result->count - overhead,
+				(unsigned long long)(result->max - overhead));
+	}
+	printf("(cycles at %lu MHz, %llu cycle measuring cost taken off)\n",
+			F_CPU / 1000000, (unsigned long long)overhead);
+	printf("stack never used: %u bytes\n", stack_free);
+	return 0;
+}
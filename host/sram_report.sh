@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# sram_report.sh
+#
+# Build time SRAM report: the .data and .bss of each module and the biggest
+# variables, next to the 2 KB the ATmega324A has. The rest is left for the
+# stack, whose real depth is shown on the device at game over (or with the
+# ':r' command line, see sram.h).
+#
+# Run after building, with the .elf file and the object files:
+#		./sram_report.sh Debug/reversi.elf Debug/*.o
+#
+# Objects built with -fdata-sections have a section per variable (.data.x,
+# .bss.y), which are all added up. Constants not in PROGMEM (.rodata) are
+# copied into RAM with the .data, so they count as .data.
+
+RAM_SIZE=2048
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 program.elf module.o ..." >&2
+	exit 1
+fi
+elf=$1
+shift
+
+echo "Module                 .data   .bss  total"
+avr-size -A "$@" | awk '
+	/^[^ ].*:/ { if (name != "") print_module(); name = $1; data = 0; bss = 0; next }
+	$1 ~ /^\.(data|rodata)/ { data += $2 }
+	$1 ~ /^\.bss/ { bss += $2 }
+	function print_module() {
+		if (data + bss > 0) printf "%-20s %7d %6d %6d\n", name, data, bss, data + bss
+	}
+	END { if (name != "") print_module() }' | sort -k4 -n -r
+
+echo
+echo "Largest variables"
+avr-nm -S --size-sort -r -t d "$elf" | awk '$3 ~ /^[bBdD]$/ { printf "%6d  %s\n", $2, $4 }' | head -15
+
+echo
+avr-size -A "$elf" | awk -v ram=$RAM_SIZE '
+	$1 ~ /^\.data/ { data += $2 }
+	$1 ~ /^\.bss/ { bss += $2 }
+	END { printf "Static %d bytes (.data %d, .bss %d), %d left for the stack\n",
+			data + bss, data, bss, ram - data - bss }'
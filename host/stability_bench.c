@@ -0,0 +1,191 @@
+/*
+ * stability_bench.c
+ *
+ * Measures how fast stable and frontier discs are found (see stability.h)
+ * and checks the answers. The board size is fixed when building (see
+ * board.h), and must fit in a bitboard:
+ *		gcc -O2 -o stability_bench stability_bench.c ../stability.c \
+ *				../bitboard.c
+ *		./stability_bench [games] [seed]
+ *
+ * Random games are played from the start. After every move the stable
+ * discs kept up to date by stability_move() must be the same as those
+ * worked out from nothing, and no disc found stable may be flipped later
+ * in the game. The positions are then timed both ways.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../stability.h"
+#include "../display.h"
+
+#if !BOARD_FITS_BITBOARD
+#error "stability.c only covers boards which fit in a bitboard"
+#endif
+
+// a game never has more moves than there are squares
+#define MAX_MOVES (BOARD_WIDTH * BOARD_HEIGHT)
+
+typedef struct {
+	Position position;		// after the move
+	uint8_t square;
+} GameMove;
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start_position(Position* position) {
+	uint8_t left = BOARD_WIDTH / 2 - 1;
+	uint8_t bottom = BOARD_HEIGHT / 2 - 1;
+	position->p1 = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom + 1));
+	position->p2 = BITBOARD_BIT(BITBOARD_SQUARE(left, bottom + 1)) |
+			BITBOARD_BIT(BITBOARD_SQUARE(left + 1, bottom));
+}
+
+// plays a random game into 'moves' and returns its length
+static int random_game(GameMove* moves) {
+	Position position;
+	start_position(&position);
+	uint8_t player = PLAYER_1;
+	int num_moves = 0;
+	int passed = 0;
+	while (passed < 2) {
+		BitBoard* own = (player == PLAYER_1) ? &position.p1 : &position.p2;
+		BitBoard* opp = (player == PLAYER_1) ? &position.p2 : &position.p1;
+		BitBoard legal = bitboard_legal_moves(*own, *opp);
+		if (legal) {
+			uint8_t choice = rand() % bitboard_count(legal);
+			uint8_t square = bitboard_pop_lowest(&legal);
+			while (choice--) {
+				square = bitboard_pop_lowest(&legal);
+			}
+			BitBoard flips = bitboard_flips(*own, *opp, square);
+			*own |= flips | BITBOARD_BIT(square);
+			*opp &= ~flips;
+			moves[num_moves].position = position;
+			moves[num_moves].square = square;
+			num_moves++;
+			passed = 0;
+		} else {
+			passed++;
+		}
+		player = (player == PLAYER_1) ? PLAYER_2 : PLAYER_1;
+	}
+	return num_moves;
+}
+
+// checks one game, returning the number of errors found
+static int check_game(const GameMove* moves, int num_moves) {
+	int errors = 0;
+	Position start;
+	start_position(&start);
+	stability_reset(&start);
+	for (int i = 0; i < num_moves; i++) {
+		const Position* position = &moves[i].position;
+		stability_move(position, moves[i].square);
+		BitBoard stable_p1 = stability_stable(PLAYER_1);
+		BitBoard stable_p2 = stability_stable(PLAYER_2);
+		if (stable_p1 != stability_find_stable(position->p1, position->p2) ||
+				stable_p2 != stability_find_stable(position->p2, position->p1)) {
+			printf("move %d: kept up to date %016llx %016llx, from nothing "
+					"%016llx %016llx\n", i + 1,
+					(unsigned long long)stable_p1, (unsigned long long)stable_p2,
+					(unsigned long long)stability_find_stable(position->p1, position->p2),
+					(unsigned long long)stability_find_stable(position->p2, position->p1));
+			errors++;
+		}
+		for (int j = i + 1; j < num_moves; j++) {
+			if ((stable_p1 & ~moves[j].position.p1) || (stable_p2 & ~moves[j].position.p2)) {
+				printf("move %d: a disc found stable is flipped by move %d\n", i + 1, j + 1);
+				errors++;
+				break;
+			}
+		}
+	}
+	return errors;
+}
+
+int main(int argc, char** argv) {
+	int num_games = argc > 1 ? atoi(argv[1]) : 1000;
+	unsigned seed = argc > 2 ? atoi(argv[2]) : 1;
+	srand(seed);
+
+	GameMove* games = malloc(sizeof(GameMove) * MAX_MOVES * num_games);
+	int* lengths = malloc(sizeof(int) * num_games);
+	if (!games || !lengths) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	long num_positions = 0;
+	long num_stable = 0;
+	long num_frontier = 0;
+	int errors = 0;
+	for (int g = 0; g < num_games; g++) {
+		GameMove* moves = &games[g * MAX_MOVES];
+		lengths[g] = random_game(moves);
+		num_positions += lengths[g];
+		errors += check_game(moves, lengths[g]);
+		for (int i = 0; i < lengths[g]; i++) {
+			const Position* position = &moves[i].position;
+			num_stable += bitboard_count(stability_find_stable(position->p1, position->p2));
+			num_frontier += bitboard_count(stability_find_frontier(position->p1, position->p2));
+		}
+	}
+	printf("%dx%d board, %d games, %ld positions\n", BOARD_WIDTH, BOARD_HEIGHT,
+			num_games, num_positions);
+	printf("player 1 has %.1f stable and %.1f frontier discs on average\n",
+			(double)num_stable / num_positions, (double)num_frontier / num_positions);
+
+	// results are summed so the calls aren't optimised away
+	BitBoard sum = 0;
+	Position start;
+	start_position(&start);
+
+	double begin = now_seconds();
+	for (int g = 0; g < num_games; g++) {
+		stability_reset(&start);
+		for (int i = 0; i < lengths[g]; i++) {
+			const GameMove* move = &games[g * MAX_MOVES + i];
+			stability_move(&move->position, move->square);
+			sum += stability_stable(PLAYER_1) + stability_stable(PLAYER_2);
+		}
+	}
+	double seconds = now_seconds() - begin;
+	printf("%-26s %12.0f positions/s\n", "stability_move()", num_positions / seconds);
+
+	begin = now_seconds();
+	for (int g = 0; g < num_games; g++) {
+		for (int i = 0; i < lengths[g]; i++) {
+			const Position* position = &games[g * MAX_MOVES + i].position;
+			sum += stability_find_stable(position->p1, position->p2) +
+					stability_find_stable(position->p2, position->p1);
+		}
+	}
+	seconds = now_seconds() - begin;
+	printf("%-26s %12.0f positions/s\n", "stability_find_stable()", num_positions / seconds);
+
+	begin = now_seconds();
+	for (int g = 0; g < num_games; g++) {
+		for (int i = 0; i < lengths[g]; i++) {
+			const Position* position = &games[g * MAX_MOVES + i].position;
+			sum += stability_find_frontier(position->p1, position->p2) +
+					stability_find_frontier(position->p2, position->p1);
+		}
+	}
+	seconds = now_seconds() - begin;
+	printf("%-26s %12.0f positions/s\n", "stability_find_frontier()", num_positions / seconds);
+
+	printf("(checksum %016llx)\n", (unsigned long long)sum);
+	if (errors) {
+		printf("%d ERRORS\n", errors);
+	}
+	free(games);
+	free(lengths);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * trace_dump.c
+ *
+ * Fetches the event trace from the device (which must be built with
+ * -DTRACE) and prints it as a timeline, or as Chrome trace JSON which can
+ * be loaded into chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Build and run on the host:
+ *		gcc -O2 -o trace_dump trace_dump.c remote_client.c
+ *		./trace_dump /dev/ttyUSB0 19200 [-j|-c] > trace.txt
+ *
+ * The timeline shows each event's time in milliseconds, the time since the
+ * event before it and what happened. -c prints the input events (buttons,
+ * keys and joystick) as a capture which replay.c can play back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "remote_client.h"
+
+#define MAX_EVENTS TRACE_SIZE
+
+static const char* event_name(uint8_t type) {
+	switch (type) {
+		case TRACE_BUTTON:		return "button";
+		case TRACE_KEY:			return "key";
+		case TRACE_ADC_X:		return "joystick x";
+		case TRACE_ADC_Y:		return "joystick y";
+		case TRACE_SPI_FLUSH:	return "led update";
+		case TRACE_LED_PIXEL:	return "led pixel";
+		case TRACE_MOVE:		return "move";
+		case TRACE_TURN_TICK:	return "turn timer";
+	}
+	return "unknown";
+}
+
+// describe an event's argument in 'text'
+static void describe(const RemoteTraceEvent* event, char* text, size_t size) {
+	switch (event->type) {
+		case TRACE_BUTTON:
+			snprintf(text, size, "B%d", event->arg);
+			break;
+		case TRACE_KEY:
+			if (event->arg >= ' ' && event->arg < 0x7F) {
+				snprintf(text, size, "'%c'", event->arg);
+			} else {
+				snprintf(text, size, "0x%02X", event->arg);
+			}
+			break;
+		case TRACE_ADC_X:
+		case TRACE_ADC_Y:
+			snprintf(text, size, "%d", event->arg * 4);
+			break;
+		case TRACE_SPI_FLUSH:
+			snprintf(text, size, "%s", event->arg == 0x00 ? "all" :
+					event->arg == 0x02 ? "row" : event->arg == 0x03 ? "column" : "?");
+			break;
+		case TRACE_LED_PIXEL:
+			snprintf(text, size, "(%d,%d)", event->arg & 0x0F, event->arg >> 4);
+			break;
+		case TRACE_MOVE:
+			snprintf(text, size, "%c%d", 'a' + (event->arg & 0x0F), (event->arg >> 4) + 1);
+			break;
+		case TRACE_TURN_TICK:
+			snprintf(text, size, "%ds left", event->arg);
+			break;
+		default:
+			snprintf(text, size, "%d", event->arg);
+	}
+}
+
+static double event_us(const RemoteTraceEvent* event) {
+	return event->time * (TRACE_TICK_NS / 1000.0);
+}
+
+static void print_timeline(const RemoteTraceEvent* events, int count) {
+	char text[32];
+	for (int i = 0; i < count; i++) {
+		double delta = i > 0 ? event_us(&events[i]) - event_us(&events[i - 1]) : 0;
+		describe(&events[i], text, sizeof(text));
+		printf("%12.3f ms  +%9.3f ms  %-12s %s\n", event_us(&events[i]) / 1000,
+				delta / 1000, event_name(events[i].type), text);
+	}
+}
+
+// joystick samples and the turn timer are shown as counters, everything
+// else as instant events
+static void print_chrome_json(const RemoteTraceEvent* events, int count) {
+	char text[32];
+	printf("{\"traceEvents\":[\n");
+	for (int i = 0; i < count; i++) {
+		const RemoteTraceEvent* event = &events[i];
+		describe(event, text, sizeof(text));
+		printf("%s", i > 0 ? ",\n" : "");
+		if (event->type == TRACE_ADC_X || event->type == TRACE_ADC_Y) {
+			printf("{\"name\":\"joystick\",\"ph\":\"C\",\"ts\":%.0f,\"pid\":1,\"tid\":1,"
+					"\"args\":{\"%c\":%d}}", event_us(event),
+					event->type == TRACE_ADC_X ? 'x' : 'y', event->arg * 4);
+		} else if (event->type == TRACE_TURN_TICK) {
+			printf("{\"name\":\"turn timer\",\"ph\":\"C\",\"ts\":%.0f,\"pid\":1,\"tid\":1,"
+					"\"args\":{\"seconds\":%d}}", event_us(event), event->arg);
+		} else {
+			printf("{\"name\":\"%s %s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.0f,"
+					"\"pid\":1,\"tid\":1}", event_name(event->type), text, event_us(event));
+		}
+	}
+	printf("\n]}\n");
+}
+
+// the inputs in the format replay.c reads, timed from the first event.
+// The x and y joystick samples are logged separately, so each one is
+// given with the last value of the other
+static void print_capture(const RemoteTraceEvent* events, int count) {
+	int joystick[2] = { 512, 512 };
+	double start_ms = count > 0 ? event_us(&events[0]) / 1000 : 0;
+	printf("# %d events from trace_dump\n", count);
+	for (int i = 0; i < count; i++) {
+		const RemoteTraceEvent* event = &events[i];
+		double ms = event_us(event) / 1000 - start_ms;
+		switch (event->type) {
+			case TRACE_BUTTON:
+				printf("%.3f button %d\n", ms, event->arg);
+				break;
+			case TRACE_KEY:
+				printf("%.3f key 0x%02X\n", ms, event->arg);
+				break;
+			case TRACE_ADC_X:
+			case TRACE_ADC_Y:
+				joystick[event->type == TRACE_ADC_Y] = event->arg * 4;
+				printf("%.3f joystick %d %d\n", ms, joystick[0], joystick[1]);
+				break;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s port baud [-j|-c]\n", argv[0]);
+		return 1;
+	}
+	int json = (argc > 3 && strcmp(argv[3], "-j") == 0);
+	int capture = (argc > 3 && strcmp(argv[3], "-c") == 0);
+
+	RemoteClient client;
+	if (remote_client_open(&client, argv[1], atol(argv[2])) < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	RemoteTraceEvent events[MAX_EVENTS];
+	int count = remote_client_read_trace(&client, events, MAX_EVENTS, 2000);
+	remote_client_close(&client);
+	if (count < 0) {
+		fprintf(stderr, "no trace (is the device built with -DTRACE?)\n");
+		return 1;
+	}
+	if (count > MAX_EVENTS) {
+		count = MAX_EVENTS;
+	}
+
+	if (json) {
+		print_chrome_json(events, count);
+	} else if (capture) {
+		print_capture(events, count);
+	} else {
+		print_timeline(events, count);
+	}
+	return 0;
+}
@@ -7,8 +7,12 @@
  */ 
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include "ledmatrix.h"
 #include "spi.h"
+#include "profile.h"
+#include "trace.h"
+#include "timer0.h"
 
 #define CMD_UPDATE_ALL 0x00
 #define CMD_UPDATE_PIXEL 0x01
@@ -17,14 +21,31 @@
 #define CMD_SHIFT_DISPLAY 0x04
 #define CMD_CLEAR_SCREEN 0x0F
 
+// the clock divider ledmatrix_setup() uses, which the matrix is known to
+// keep up with
+#define SAFE_CLOCK_DIVIDER 128
+
+// SPI clock dividers and gaps between bytes (in microseconds) tried by
+// ledmatrix_calibrate(), fastest first
+static const uint8_t calibration_dividers[] PROGMEM = { 2, 4, 8, 16, 32, 64 };
+static const uint8_t calibration_gaps[] PROGMEM = { 0, 2, 8, 32 };
+#define NUM_CALIBRATION_DIVIDERS sizeof(calibration_dividers)
+#define NUM_CALIBRATION_GAPS sizeof(calibration_gaps)
+// whole display test patterns sent for each setting, and updates timed
+// to work out the throughput
+#define CALIBRATION_PATTERNS 4
+#define CALIBRATION_TIMED_UPDATES 16
+
 void ledmatrix_setup(void) {
 	// Setup SPI - we divide the clock by 128.
 	// (This speed guarantees the SPI buffer will never overflow on
 	// the LED matrix.)
-	spi_setup_master(128);
+	spi_setup_master(SAFE_CLOCK_DIVIDER);
+	spi_set_byte_gap(0);
 }
 
 void ledmatrix_update_all(MatrixData data) {
+	TRACE_LOG(TRACE_SPI_FLUSH, CMD_UPDATE_ALL);
 	(void)spi_send_byte(CMD_UPDATE_ALL);
 	for(uint8_t y=0; y<MATRIX_NUM_ROWS; y++) {
 		for(uint8_t x=0; x<MATRIX_NUM_COLUMNS; x++) {
@@ -33,14 +54,27 @@ void ledmatrix_update_all(MatrixData data) {
 	}
 }
 
+void ledmatrix_update_all_P(const PixelColour* data) {
+	TRACE_LOG(TRACE_SPI_FLUSH, CMD_UPDATE_ALL);
+	(void)spi_send_byte(CMD_UPDATE_ALL);
+	for(uint8_t y=0; y<MATRIX_NUM_ROWS; y++) {
+		for(uint8_t x=0; x<MATRIX_NUM_COLUMNS; x++) {
+			(void)spi_send_byte(pgm_read_byte(&data[x * MATRIX_NUM_ROWS + y]));
+		}
+	}
+}
+
 void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
 	if(x >= MATRIX_NUM_COLUMNS || y >= MATRIX_NUM_ROWS) {
 		// Position isn't valid - we ignore the request.
 		return;
 	}
+	PROFILE_BEGIN(PROFILE_LED_UPDATE_PIXEL);
+	TRACE_LOG(TRACE_LED_PIXEL, ((y & 0x07)<<4) | (x & 0x0F));
 	(void)spi_send_byte(CMD_UPDATE_PIXEL);
 	(void)spi_send_byte( ((y & 0x07)<<4) | (x & 0x0F));
 	(void)spi_send_byte(pixel);
+	PROFILE_END(PROFILE_LED_UPDATE_PIXEL);
 }
 
 void ledmatrix_update_row(uint8_t y, MatrixRow row) {
@@ -48,6 +82,7 @@ void ledmatrix_update_row(uint8_t y, MatrixRow row) {
 		// y value is too large - we ignore the request
 		return;
 	}
+	TRACE_LOG(TRACE_SPI_FLUSH, CMD_UPDATE_ROW);
 	(void)spi_send_byte(CMD_UPDATE_ROW);
 	(void)spi_send_byte(y & 0x07);	// row number
 	for(uint8_t x = 0; x<MATRIX_NUM_COLUMNS; x++) {
@@ -60,6 +95,7 @@ void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
 		// x value is too large - we ignore the request
 		return;
 	}
+	TRACE_LOG(TRACE_SPI_FLUSH, CMD_UPDATE_COL);
 	(void)spi_send_byte(CMD_UPDATE_COL);
 	(void)spi_send_byte(x & 0x0F); // column number
 	for(uint8_t y = 0; y<MATRIX_NUM_ROWS; y++) {
@@ -114,3 +150,69 @@ void set_matrix_row_to_colour(MatrixRow matrix_row, PixelColour colour) {
 		matrix_row[column] = colour;
 	}
 }
+
+// Sends a whole display of test pattern 'pattern' and checks that each
+// byte comes back while the next one is sent. Returns 1 if they all did
+static uint8_t send_test_pattern(uint8_t pattern) {
+	uint8_t previous = CMD_UPDATE_ALL;
+	uint8_t ok = 1;
+	(void)spi_send_byte(CMD_UPDATE_ALL);
+	for(uint8_t i = 0; i < MATRIX_NUM_ROWS * MATRIX_NUM_COLUMNS; i++) {
+		// every byte differs from the one before, so a byte which is
+		// lost or repeated shows up
+		uint8_t byte = (uint8_t)(i * 37 + pattern * 101);
+		if(spi_send_byte(byte) != previous) {
+			ok = 0;
+		}
+		previous = byte;
+	}
+	return ok;
+}
+
+static uint8_t settings_work(void) {
+	for(uint8_t pattern = 0; pattern < CALIBRATION_PATTERNS; pattern++) {
+		if(!send_test_pattern(pattern)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// time some whole display updates at the current speed
+static uint16_t updates_per_second(void) {
+	uint32_t start_time = get_current_time();
+	for(uint8_t i = 0; i < CALIBRATION_TIMED_UPDATES; i++) {
+		(void)send_test_pattern(i);
+	}
+	uint32_t elapsed = get_current_time() - start_time;
+	if(elapsed == 0) {
+		elapsed = 1;
+	}
+	return (uint16_t)(CALIBRATION_TIMED_UPDATES * 1000UL / elapsed);
+}
+
+void ledmatrix_calibrate(LedMatrixCalibration* result) {
+	ledmatrix_setup();
+	result->safe_updates_per_second = updates_per_second();
+
+	result->echoed = 0;
+	result->divider = SAFE_CLOCK_DIVIDER;
+	result->byte_gap = 0;
+	for(uint8_t d = 0; d < NUM_CALIBRATION_DIVIDERS && !result->echoed; d++) {
+		for(uint8_t g = 0; g < NUM_CALIBRATION_GAPS; g++) {
+			spi_setup_master(pgm_read_byte(&calibration_dividers[d]));
+			spi_set_byte_gap(pgm_read_byte(&calibration_gaps[g]));
+			if(settings_work()) {
+				result->divider = pgm_read_byte(&calibration_dividers[d]);
+				result->byte_gap = pgm_read_byte(&calibration_gaps[g]);
+				result->echoed = 1;
+				break;
+			}
+		}
+	}
+	result->updates_per_second = result->echoed ? updates_per_second() : 0;
+
+	// The echo only shows that the matrix's SPI hardware kept up, not that
+	// its firmware handled every byte, so go back to the safe speed
+	ledmatrix_setup();
+}
@@ -27,11 +27,34 @@ typedef PixelColour MatrixColumn[MATRIX_NUM_ROWS];
 // below are used.
 void ledmatrix_setup(void);
 
+// The result of ledmatrix_calibrate()
+typedef struct {
+	uint8_t divider;			// fastest SPI clock divider which echoed
+	uint8_t byte_gap;			// and microseconds waited after each byte
+	uint8_t echoed;				// 0 if no rate echoed (see below)
+	uint16_t updates_per_second;	// whole display updates per second there
+	uint16_t safe_updates_per_second;	// and at the divider in use (128)
+} LedMatrixCalibration;
+
+// Measure how fast the LED matrix could be driven, without changing the
+// speed used. Each clock divider spi_setup_master() supports is tried,
+// fastest first, with no gap between bytes and then with longer and longer
+// gaps, until every byte of several test patterns is read back correctly.
+// (The matrix's SPI data register shifts each byte it received back out
+// while the next one is sent.) That only shows the matrix's SPI hardware
+// kept up, not that its firmware handled each byte, so the safe divider of
+// 128 stays in use and the result is just reported.
+// The display is left showing a test pattern, so redraw it afterwards.
+void ledmatrix_calibrate(LedMatrixCalibration* result);
+
 // Functions to update the display
 // For those functions which take an x or a y value, the value must be valid
 // or the request will be ignored. (i.e. x must be < MATRIX_NUM_COLUMNS
 // and y must be < MATRIX_NUM_ROWS)
 void ledmatrix_update_all(MatrixData data);
+// As ledmatrix_update_all(), but the data is read from program memory
+// (i.e. a MatrixData declared PROGMEM)
+void ledmatrix_update_all_P(const PixelColour* data);
 void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel);
 void ledmatrix_update_row(uint8_t y, MatrixRow row);
 void ledmatrix_update_column(uint8_t x, MatrixColumn col);
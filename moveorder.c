@@ -0,0 +1,106 @@
+/*
+ * moveorder.c
+ *
+ * Killer moves, history table and square priorities. See moveorder.h.
+ */
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "moveorder.h"
+
+#define NUM_KILLERS 2
+#define NO_KILLER 0xFF
+
+// static priority of each square (bitboard order), higher first, by its
+// distances from the edges (see BITBOARD_TABLE()). Corners can never be
+// flipped, edges are hard to attack, the squares next to a corner give it
+// away. On 8x8:
+//	7, 1, 5, 4, 4, 5, 1, 7,
+//	1, 0, 2, 2, 2, 2, 0, 1,
+//	5, 2, 3, 3, 3, 3, 2, 5,
+//	4, 2, 3, 3, 3, 3, 2, 4, ...
+#define PRIORITY(a, b) ((a) <= (b) ? PRIORITY_SORTED(a, b) : PRIORITY_SORTED(b, a))
+#define PRIORITY_SORTED(a, b) ((a) == 0 ? ((b) == 0 ? 7 : (b) == 1 ? 1 : (b) == 2 ? 5 : 4) \
+		: (a) == 1 ? ((b) == 1 ? 0 : 2) : 3)
+static const uint8_t square_priorities[64] PROGMEM = BITBOARD_TABLE(PRIORITY);
+
+static uint8_t flags = MOVEORDER_ALL;
+static uint8_t killers[AI_MAX_DEPTH][NUM_KILLERS];
+// a byte per square, all halved whenever one would overflow
+static uint8_t history[64];
+
+void moveorder_set_flags(uint8_t new_flags) {
+	flags = new_flags;
+}
+
+void moveorder_clear(void) {
+	for (uint8_t ply = 0; ply < AI_MAX_DEPTH; ply++) {
+		for (uint8_t i = 0; i < NUM_KILLERS; i++) {
+			killers[ply][i] = NO_KILLER;
+		}
+	}
+	for (uint8_t square = 0; square < 64; square++) {
+		history[square] = 0;
+	}
+}
+
+uint8_t moveorder_next(BitBoard* moves, uint8_t ply) {
+	if (flags & MOVEORDER_KILLERS) {
+		for (uint8_t i = 0; i < NUM_KILLERS; i++) {
+			uint8_t killer = killers[ply][i];
+			if (killer != NO_KILLER && (*moves & BITBOARD_BIT(killer))) {
+				*moves &= ~BITBOARD_BIT(killer);
+				return killer;
+			}
+		}
+	}
+	if (!(flags & (MOVEORDER_SQUARES | MOVEORDER_HISTORY))) {
+		return bitboard_pop_lowest(moves);
+	}
+
+	// the move with the highest priority then history, the lowest square
+	// of those which tie. The moves are walked a row (byte) at a time as
+	// 64 bit shifts are slow on the AVR
+	BitBoard rest = *moves;
+	uint8_t best_square = 0;
+	int16_t best_key = -1;
+	for (uint8_t row = 0; row < 64; row += 8) {
+		uint8_t bits = (uint8_t)rest;
+		for (uint8_t square = row; bits != 0; square++, bits >>= 1) {
+			if (!(bits & 0x01)) {
+				continue;
+			}
+			int16_t key = 0;
+			if (flags & MOVEORDER_SQUARES) {
+				key = (int16_t)pgm_read_byte(&square_priorities[square]) << 8;
+			}
+			if (flags & MOVEORDER_HISTORY) {
+				key |= history[square];
+			}
+			if (key > best_key) {
+				best_key = key;
+				best_square = square;
+			}
+		}
+		rest >>= 8;
+	}
+	*moves &= ~BITBOARD_BIT(best_square);
+	return best_square;
+}
+
+void moveorder_cutoff(uint8_t square, uint8_t ply, uint8_t depth) {
+	if (killers[ply][0] != square) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = square;
+	}
+	// deeper cut offs save more of the tree, so count for more
+	uint8_t bonus = depth * depth;
+	if (history[square] > 0xFF - bonus) {
+		for (uint8_t i = 0; i < 64; i++) {
+			history[i] >>= 1;
+		}
+	}
+	history[square] += bonus;
+}
@@ -0,0 +1,50 @@
+/*
+ * moveorder.h
+ *
+ * Order in which the search tries the legal moves at a node. Alpha-beta
+ * cuts off more of the tree the sooner it tries the best move, so rather
+ * than taking moves lowest square first the search asks for the most
+ * promising move left each time:
+ *		- a killer move for this ply (a move which caused a cut off at the
+ *		  same ply elsewhere in the tree), then
+ *		- the move on the square with the highest static priority (corners
+ *		  first, the squares next to the corners last), with
+ *		- ties broken by the history table, which scores each square by how
+ *		  often (and how deep) moves there have caused cut offs.
+ * Each part can be turned off with moveorder_set_flags(), e.g. to measure
+ * what it is worth (see host/order_bench.c).
+ *
+ * The killers and history are cleared at the start of each search, so a
+ * search only depends on the position and how deep it goes.
+ */
+
+#ifndef MOVEORDER_H_
+#define MOVEORDER_H_
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "ai.h"
+
+// parts of the ordering which are used
+#define MOVEORDER_KILLERS	0x01
+#define MOVEORDER_SQUARES	0x02
+#define MOVEORDER_HISTORY	0x04
+#define MOVEORDER_ALL		0x07
+
+// flags are MOVEORDER_ALL unless changed
+void moveorder_set_flags(uint8_t flags);
+
+// forget the killers and history, at the start of a search
+void moveorder_clear(void);
+
+// removes the move to try next from 'moves' (which must not be empty) and
+// returns its square. 'ply' is how far the node is from the root, which
+// must be less than AI_MAX_DEPTH
+uint8_t moveorder_next(BitBoard* moves, uint8_t ply);
+
+// the move on 'square' caused a cut off at 'ply', with 'depth' plies left
+// to search below that node
+void moveorder_cutoff(uint8_t square, uint8_t ply, uint8_t depth);
+
+#endif /* MOVEORDER_H_ */
@@ -24,6 +24,8 @@ typedef uint8_t PixelColour;
 #define COLOUR_LIGHT_YELLOW 0x35
 #define COLOUR_LIGHT_GREEN	0x11
 #define COLOUR_YELLOW_GREEN 0xFF
+#define COLOUR_DIM_RED		0x02
+#define COLOUR_DIM_GREEN	0x20
 
 
 #endif /* PIXEL_COLOUR_H_ */
\ No newline at end of file
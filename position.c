@@ -0,0 +1,155 @@
+/*
+ * position.c
+ *
+ * Packing, symmetries and keys for Positions. See position.h.
+ *
+ * The transforms work on the whole bitboard with shifts and masks. A board
+ * smaller than 8x8 sits in the bottom left corner of the bitboard, so after
+ * reversing a full row or column it is shifted back down into the corner.
+ */
+
+#include <stdint.h>
+
+#include "position.h"
+
+#if BOARD_FITS_BITBOARD
+
+void position_pack(const Position* position, uint8_t* bytes) {
+	BitBoard p1 = position->p1;
+	BitBoard p2 = position->p2;
+	for (uint8_t i = 0; i < 8; i++) {
+		bytes[i] = (uint8_t)p1;
+		bytes[i + 8] = (uint8_t)p2;
+		p1 >>= 8;
+		p2 >>= 8;
+	}
+}
+
+void position_unpack(Position* position, const uint8_t* bytes) {
+	BitBoard p1 = 0;
+	BitBoard p2 = 0;
+	for (int8_t i = 7; i >= 0; i--) {
+		p1 = (p1 << 8) | bytes[i];
+		p2 = (p2 << 8) | bytes[i + 8];
+	}
+	position->p1 = p1;
+	position->p2 = p2;
+}
+
+// swap square (x, y) with (y, x)
+static BitBoard transpose(BitBoard b) {
+	BitBoard t;
+	t = 0x0F0F0F0F00000000ULL & (b ^ (b << 28));
+	b ^= t ^ (t >> 28);
+	t = 0x3333000033330000ULL & (b ^ (b << 14));
+	b ^= t ^ (t >> 14);
+	t = 0x5500550055005500ULL & (b ^ (b << 7));
+	b ^= t ^ (t >> 7);
+	return b;
+}
+
+// reverse the order of the squares in each row
+static BitBoard mirror_x(BitBoard b) {
+	b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+	b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+	b = ((b >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((b & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	// the rows now end at x = 7, each moves down within its own byte
+	return b >> (8 - BOARD_WIDTH);
+}
+
+// reverse the order of the rows
+static BitBoard mirror_y(BitBoard b) {
+	BitBoard result = 0;
+	// a byte at a time, which is also the quickest way on the AVR
+	for (uint8_t i = 0; i < 8; i++) {
+		result = (result << 8) | (uint8_t)b;
+		b >>= 8;
+	}
+	return result >> (8 * (8 - BOARD_HEIGHT));
+}
+
+BitBoard position_transform_bitboard(BitBoard b, uint8_t symmetry) {
+	if (symmetry & POSITION_TRANSPOSE) {
+		b = transpose(b);
+	}
+	if (symmetry & POSITION_MIRROR_X) {
+		b = mirror_x(b);
+	}
+	if (symmetry & POSITION_MIRROR_Y) {
+		b = mirror_y(b);
+	}
+	return b;
+}
+
+void position_transform(const Position* from, Position* to, uint8_t symmetry) {
+	to->p1 = position_transform_bitboard(from->p1, symmetry);
+	to->p2 = position_transform_bitboard(from->p2, symmetry);
+}
+
+uint8_t position_transform_square(uint8_t square, uint8_t symmetry) {
+	uint8_t x = BITBOARD_SQUARE_X(square);
+	uint8_t y = BITBOARD_SQUARE_Y(square);
+	if (symmetry & POSITION_TRANSPOSE) {
+		uint8_t t = x;
+		x = y;
+		y = t;
+	}
+	if (symmetry & POSITION_MIRROR_X) {
+		x = BOARD_WIDTH - 1 - x;
+	}
+	if (symmetry & POSITION_MIRROR_Y) {
+		y = BOARD_HEIGHT - 1 - y;
+	}
+	return BITBOARD_SQUARE(x, y);
+}
+
+uint8_t position_untransform_square(uint8_t square, uint8_t symmetry) {
+	uint8_t x = BITBOARD_SQUARE_X(square);
+	uint8_t y = BITBOARD_SQUARE_Y(square);
+	// the same steps as position_transform_square() in reverse order
+	if (symmetry & POSITION_MIRROR_Y) {
+		y = BOARD_HEIGHT - 1 - y;
+	}
+	if (symmetry & POSITION_MIRROR_X) {
+		x = BOARD_WIDTH - 1 - x;
+	}
+	if (symmetry & POSITION_TRANSPOSE) {
+		uint8_t t = x;
+		x = y;
+		y = t;
+	}
+	return BITBOARD_SQUARE(x, y);
+}
+
+uint8_t position_canonical(const Position* position, Position* canonical) {
+	// the canonical form is the one with the smallest p1 (then p2)
+	Position best = *position;
+	uint8_t best_symmetry = 0;
+	// (the symmetries are numbered so that 4 to 7 are the ones which
+	// transpose, which only square boards have)
+	for (uint8_t symmetry = 1; symmetry < POSITION_NUM_SYMMETRIES; symmetry++) {
+		Position other;
+		position_transform(position, &other, symmetry);
+		if (other.p1 < best.p1 || (other.p1 == best.p1 && other.p2 < best.p2)) {
+			best = other;
+			best_symmetry = symmetry;
+		}
+	}
+	*canonical = best;
+	return best_symmetry;
+}
+
+uint32_t position_key(const Position* position, uint8_t player) {
+	Position canonical;
+	uint8_t bytes[POSITION_BYTES];
+	position_canonical(position, &canonical);
+	position_pack(&canonical, bytes);
+	// 32 bit FNV-1a over the packed position and the player to move
+	uint32_t hash = 2166136261UL;
+	for (uint8_t i = 0; i < POSITION_BYTES; i++) {
+		hash = (hash ^ bytes[i]) * 16777619UL;
+	}
+	return (hash ^ player) * 16777619UL;
+}
+
+#endif /* BOARD_FITS_BITBOARD */
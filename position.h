@@ -0,0 +1,72 @@
+/*
+ * position.h
+ *
+ * Compact positions. A Position is the board as two bitboards, one per
+ * player: 16 bytes rather than the 64 of the board array in game.c. It is
+ * the form positions are kept in wherever more than one is stored or sent
+ * (the computer opponent, saved games, the remote control protocol and
+ * host side tools), so they can all share the same code.
+ *
+ * The board's symmetries (reflections and, for a square board, rotations)
+ * give up to eight equivalent positions. position_canonical() picks the
+ * same one of them whichever one it is given, so a position can be looked
+ * up by a key which doesn't depend on how the board happens to be turned.
+ *
+ * Only boards which fit in a bitboard (see board.h) have Positions.
+ */
+
+#ifndef POSITION_H_
+#define POSITION_H_
+
+#include <stdint.h>
+
+#include "board.h"
+#include "bitboard.h"
+
+#if BOARD_FITS_BITBOARD
+
+typedef struct {
+	BitBoard p1;	// discs belonging to PLAYER_1
+	BitBoard p2;	// discs belonging to PLAYER_2
+} Position;
+
+// size of a packed position
+#define POSITION_BYTES 16
+
+// A symmetry is a combination of these, applied in this order: swap x
+// and y (square boards only), then reverse x, then reverse y
+#define POSITION_TRANSPOSE	0x04
+#define POSITION_MIRROR_X	0x01
+#define POSITION_MIRROR_Y	0x02
+
+#if BOARD_WIDTH == BOARD_HEIGHT
+#define POSITION_NUM_SYMMETRIES 8
+#else
+#define POSITION_NUM_SYMMETRIES 4
+#endif
+
+// write the position as 16 bytes (p1 then p2, each least significant byte
+// first) and read it back. This is the byte order used by remote.h
+void position_pack(const Position* position, uint8_t* bytes);
+void position_unpack(Position* position, const uint8_t* bytes);
+
+// apply 'symmetry' to a bitboard, a position or a square
+BitBoard position_transform_bitboard(BitBoard b, uint8_t symmetry);
+void position_transform(const Position* from, Position* to, uint8_t symmetry);
+uint8_t position_transform_square(uint8_t square, uint8_t symmetry);
+
+// undo position_transform_square(), e.g. to turn a move found for a
+// canonical position back into a move on the real board
+uint8_t position_untransform_square(uint8_t square, uint8_t symmetry);
+
+// find the canonical form of 'position' (which can be the same as
+// 'canonical'). Returns the symmetry which turns 'position' into it
+uint8_t position_canonical(const Position* position, Position* canonical);
+
+// a 32 bit hash of the canonical form of 'position' with 'player' to move.
+// Equivalent positions have the same key
+uint32_t position_key(const Position* position, uint8_t player);
+
+#endif /* BOARD_FITS_BITBOARD */
+
+#endif /* POSITION_H_ */
@@ -0,0 +1,132 @@
+/*
+ * profile.c
+ *
+ * Cycle counting profiler using Timer 1. See profile.h.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "profile.h"
+#include "terminalio.h"
+
+#ifdef PROFILE
+
+typedef struct {
+	uint32_t min;
+	uint32_t max;
+	// total and count stop together once either is full (after about 9
+	// minutes of cycles, or 65535 runs), so the average stays right
+	uint32_t total;
+	uint16_t count;
+} ProfileZone;
+
+static ProfileZone zones[PROFILE_NUM_ZONES];
+
+// upper 16 bits of the cycle count
+static volatile uint16_t timer1_overflows;
+
+// cycles taken by an empty PROFILE_BEGIN/PROFILE_END pair
+static uint32_t overhead;
+
+static const char zone_names[PROFILE_NUM_ZONES][20] PROGMEM = {
+	"is_valid_position",
+	"place_a_piece",
+	"flash_cursor",
+	"ledmatrix_pixel",
+	"score_in_terminal",
+	"ai_search_step"
+};
+
+void init_profiler(void) {
+	/* Normal mode, no prescaling, so TCNT1 counts every clock cycle and
+	 * overflows every 65536 cycles (about 8ms) */
+	TCCR1A = 0;
+	TCCR1B = (1<<CS10);
+	TCNT1 = 0;
+	timer1_overflows = 0;
+	TIFR1 = (1<<TOV1);
+	TIMSK1 |= (1<<TOIE1);
+
+	/* Measure the cost of the macros themselves */
+	overhead = 0;
+	PROFILE_BEGIN(PROFILE_NUM_ZONES);
+	uint32_t end = profile_now();
+	overhead = end - profile_start_PROFILE_NUM_ZONES;
+	profile_reset();
+}
+
+uint32_t profile_now(void) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	uint16_t low = TCNT1;
+	uint16_t high = timer1_overflows;
+	/* If the timer has overflowed but the interrupt hasn't run yet then
+	 * count the overflow here (only if the low half was read after it) */
+	if((TIFR1 & (1<<TOV1)) && low < 0x8000) {
+		high++;
+	}
+	if(interrupts_on) {
+		sei();
+	}
+	return ((uint32_t)high << 16) | low;
+}
+
+void profile_record(uint8_t zone, uint32_t cycles) {
+	if(zone >= PROFILE_NUM_ZONES) {
+		return;
+	}
+	cycles = (cycles > overhead) ? cycles - overhead : 0;
+	ProfileZone* z = &zones[zone];
+	if(z->count == 0 || cycles < z->min) {
+		z->min = cycles;
+	}
+	if(cycles > z->max) {
+		z->max = cycles;
+	}
+	if(z->count < 0xFFFF && z->total <= 0xFFFFFFFF - cycles) {
+		z->total += cycles;
+		z->count++;
+	}
+}
+
+void profile_reset(void) {
+	for(uint8_t i = 0; i < PROFILE_NUM_ZONES; i++) {
+		zones[i].min = 0;
+		zones[i].max = 0;
+		zones[i].total = 0;
+		zones[i].count = 0;
+	}
+}
+
+/* The report isn't time critical, so printf is used for the 32 bit
+ * numbers */
+static void print_cycles(uint32_t cycles) {
+	printf_P(PSTR("%10lu"), cycles);
+}
+
+void profile_report(uint8_t y) {
+	move_terminal_cursor(1, y++);
+	terminal_print_P(PSTR("zone                    count       min       max   average"));
+	for(uint8_t i = 0; i < PROFILE_NUM_ZONES; i++) {
+		ProfileZone z = zones[i];
+		move_terminal_cursor(1, y++);
+		clear_to_end_of_line();
+		terminal_print_P(zone_names[i]);
+		move_terminal_cursor(20, y - 1);
+		terminal_print_number(z.count, 10);
+		print_cycles(z.min);
+		print_cycles(z.max);
+		print_cycles(z.count ? z.total / z.count : 0);
+	}
+}
+
+ISR(TIMER1_OVF_vect) {
+	timer1_overflows++;
+}
+
+#endif /* PROFILE */
@@ -0,0 +1,66 @@
+/*
+ * profile.h
+ *
+ * Cycle counting profiler. Timer 1 counts every clock cycle (extended to
+ * 32 bits by counting its overflows), and each named zone keeps the
+ * minimum, maximum and total cycles and the number of times it has run.
+ * Once the total or the count is full neither goes up any more, so the
+ * average is of the runs counted (the minimum and maximum carry on).
+ *
+ *		PROFILE_BEGIN(PROFILE_FLASH_CURSOR);
+ *		... code being measured ...
+ *		PROFILE_END(PROFILE_FLASH_CURSOR);
+ *
+ * Profiling is only compiled in when PROFILE is defined (e.g. -DPROFILE),
+ * otherwise the macros and functions below compile to nothing.
+ * The cost of the macros themselves is measured in init_profiler() and
+ * taken off every measurement.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+// the zones which can be measured. Add new zones before PROFILE_NUM_ZONES
+// and give them a name in profile.c
+#define PROFILE_IS_VALID_POSITION	0
+#define PROFILE_PLACE_A_PIECE		1
+#define PROFILE_FLASH_CURSOR		2
+#define PROFILE_LED_UPDATE_PIXEL	3
+#define PROFILE_SCORE_IN_TERMINAL	4
+#define PROFILE_AI_SEARCH_STEP		5
+#define PROFILE_NUM_ZONES			6
+
+#ifdef PROFILE
+
+// start Timer 1 counting at the full clock rate. Must be called before
+// interrupts are turned on
+void init_profiler(void);
+
+// current cycle count
+uint32_t profile_now(void);
+
+// add a measurement to a zone
+void profile_record(uint8_t zone, uint32_t cycles);
+
+// clear every zone
+void profile_reset(void);
+
+// print the table of zones to the terminal, starting at row 'y'
+void profile_report(uint8_t y);
+
+#define PROFILE_BEGIN(zone) uint32_t profile_start_##zone = profile_now()
+#define PROFILE_END(zone) profile_record(zone, profile_now() - profile_start_##zone)
+
+#else
+
+#define init_profiler()
+#define profile_reset()
+#define profile_report(y)
+#define PROFILE_BEGIN(zone)
+#define PROFILE_END(zone)
+
+#endif /* PROFILE */
+
+#endif /* PROFILE_H_ */
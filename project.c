@@ -20,8 +20,16 @@
 #include "serialio.h"
 #include "terminalio.h"
 #include "timer0.h"
+#include "ai.h"
+#include "remote.h"
+#include "profile.h"
+#include "sram.h"
+#include "save.h"
+#include "animation.h"
 
+#ifndef F_CPU
 #define F_CPU 8000000L
+#endif
 #include <util/delay.h>
 
 // Function prototypes - these are defined below (after main()) in the order
@@ -31,6 +39,28 @@ void start_screen(void);
 void new_game(void);
 void play_game(void);
 void handle_game_over(void);
+void show_serial_report(void);
+void show_led_report(void);
+void show_computer_level(void);
+
+// how new_game() started the game, see save_resume()
+static uint8_t resume_flags;
+
+// ai_search_id() of the search the computer opponent started
+static uint8_t computer_search_id;
+
+// the board has changed (or the computer no longer plays) other than by
+// the computer's own move, so any search it has started is for a position
+// which is gone. (If the search is now an analysis for remote control,
+// that isn't the computer's to abort)
+static void abandon_computer_search(uint8_t* computer_thinking) {
+	if (*computer_thinking) {
+		if (ai_search_id() == computer_search_id) {
+			ai_abort();
+		}
+		*computer_thinking = 0;
+	}
+}
 
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
@@ -39,8 +69,11 @@ int main(void) {
 	initialise_hardware();
 	
 	// Show the splash screen message. Returns when display
-	// is complete
-	start_screen();
+	// is complete. It is skipped if a game which was interrupted by
+	// a reset is about to be resumed
+	if (!save_game_available()) {
+		start_screen();
+	}
 	
 	// Loop forever,
 	while(1) {
@@ -58,6 +91,8 @@ void initialise_hardware(void) {
 	init_serial_stdio(19200,0);
 	
 	init_timer0();
+	init_profiler();
+	init_save();
 	
 	// Turn on global interrupts
 	sei();
@@ -70,13 +105,21 @@ void start_screen(void) {
 	printf_P(PSTR("Reversi"));
 	move_terminal_cursor(10,12);
 	printf_P(PSTR("CSSE2010/7201 project by Yebai He s4546681"));
+	show_computer_level();
 	
 	// Output the static start screen and wait for a push button 
 	// to be pushed or a serial input of 's'
 	start_display();
+	// which then scrolls round while we wait
+	start_display_marquee();
+	uint32_t last_marquee_time = get_current_time();
 	
 	// Wait until a button is pressed, or 's' is pressed on the terminal
 	while(1) {
+		if (get_current_time() >= last_marquee_time + START_MARQUEE_FRAME_MS) {
+			display_marquee_step();
+			last_marquee_time += START_MARQUEE_FRAME_MS;
+		}
 		// First check for if a 's' is pressed
 		// There are two steps to this
 		// 1) collect any serial input (if available)
@@ -89,12 +132,74 @@ void start_screen(void) {
 		if (serial_input == 's' || serial_input == 'S') {
 			break;
 		}
+		// 'b' shows the baud rate table and measures the serial throughput
+		if (serial_input == 'b' || serial_input == 'B') {
+			show_serial_report();
+		}
+		// '1' to '5' pick how strong the computer opponent is
+		if (serial_input >= '1' && serial_input < '1' + AI_NUM_LEVELS) {
+			ai_set_level(serial_input - '0');
+			show_computer_level();
+		}
+		// 'l' measures how fast the LED matrix could be driven
+		if (serial_input == 'l' || serial_input == 'L') {
+			show_led_report();
+			start_display();
+			start_display_marquee();
+		}
 		// Next check for any button presses
 		int8_t btn = button_pushed();
 		if (btn != NO_BUTTON_PUSHED) {
 			break;
 		}
 	}
+	sram_end_phase(SRAM_PHASE_START_SCREEN);
+}
+
+void show_computer_level(void) {
+	move_terminal_cursor(10,13);
+	printf_P(PSTR("Computer level: %d (press 1-%d to change)"), ai_get_level(),
+			AI_NUM_LEVELS);
+}
+
+void show_serial_report(void) {
+	move_terminal_cursor(10,14);
+	printf_P(PSTR("Baud     UBRR U2X Error"));
+	uint8_t row = 15;
+	long baud;
+	for (uint8_t i = 0; (baud = serial_standard_baud_rate(i)) != 0; i++) {
+		uint16_t ubrr;
+		uint8_t double_speed;
+		int16_t error = serial_baud_error(baud, &ubrr, &double_speed);
+		int16_t abs_error = error < 0 ? -error : error;
+		move_terminal_cursor(10,row++);
+		printf_P(PSTR("%-8ld %4u %3u %c%d.%d%%%s"), baud, ubrr, double_speed,
+				error < 0 ? '-' : ' ', abs_error / 10, abs_error % 10,
+				abs_error > SERIAL_MAX_BAUD_ERROR ? " too far off" : "");
+	}
+
+	SerialSelfTest result;
+	serial_self_test(&result);
+	move_terminal_cursor(10,row + 1);
+	printf_P(PSTR("Throughput: %lu bytes/s, UART interrupt %u.%u%% of CPU, %u ns/byte"),
+			result.bytes_per_second, result.isr_load_permille / 10,
+			result.isr_load_permille % 10, result.isr_ns_per_byte);
+}
+
+void show_led_report(void) {
+	LedMatrixCalibration calibration;
+	ledmatrix_calibrate(&calibration);
+	move_terminal_cursor(10,27);
+	printf_P(PSTR("LED matrix: %u whole display updates per second at SPI clock / 128"),
+			calibration.safe_updates_per_second);
+	move_terminal_cursor(10,28);
+	if (calibration.echoed) {
+		printf_P(PSTR("Echoes at SPI clock / %u, %u us between bytes: %u updates per second"),
+				calibration.divider, calibration.byte_gap,
+				calibration.updates_per_second);
+	} else {
+		printf_P(PSTR("No faster SPI clock echoes"));
+	}
 }
 
 void new_game(void) {
@@ -104,7 +209,19 @@ void new_game(void) {
 	// Initialise the game and display
 	initialise_board();
 
+	// carry on with a saved game that didn't finish, otherwise start
+	// saving this one
+	if (save_game_available()) {
+		resume_flags = save_resume();
+	} else {
+		resume_flags = 0;
+		save_new_game();
+	}
+
+	score_labels_in_terminal();
 	score_in_terminal();
+	ai_reset_step_time();
+	serial_reset_stats();
 
 	// Clear a button push or serial input if any are waiting
 	// (The cast to void means the return value is ignored.)
@@ -128,7 +245,9 @@ void play_game(void) {
 	// last_time_seven = get_current_time();
 
 	uint8_t is_game_pause = 0;
-	uint8_t is_timed_game = 0;
+	uint8_t is_timed_game = (resume_flags & SAVE_RESUMED_TIMED) != 0;
+	uint8_t is_computer_game = 0;	// computer plays green (player 2)
+	uint8_t computer_thinking = 0;
 	
 	// We play the game until it's over
 	while(!is_game_over()) {
@@ -136,6 +255,8 @@ void play_game(void) {
 		// We need to check if any button has been pushed, this will be
 		// NO_BUTTON_PUSHED if no button has been pushed
 		btn = button_pushed();
+		uint8_t computer_to_move = is_computer_game && 
+				get_current_player() == PLAYER_2;
 		
 		if (btn == BUTTON2_PUSHED && is_game_pause == 0) {
 			// If button 2 is pushed, move left, 
@@ -145,11 +266,9 @@ void play_game(void) {
 		if (btn == BUTTON1_PUSHED && is_game_pause == 0) {
 			move_display_cursor(0, 1);
 		}
-		// move with keyboard
-		char serial_input = -1;
-		if (serial_input_available()) {
-			serial_input = fgetc(stdin);
-		}
+		// move with keyboard (remote control frames are handled here too)
+		remote_set_game_state(is_game_pause, computer_to_move);
+		char serial_input = (char)remote_read_input();
 		if ((serial_input == 'w' || serial_input == 'W') && is_game_pause == 0) {
 			move_display_cursor(0, 1);
 		}
@@ -164,10 +283,74 @@ void play_game(void) {
 		}
 
 		// place a piece starting from red
-		if ((btn == BUTTON0_PUSHED || serial_input == ' ') && is_game_pause == 0) {
+		if ((btn == BUTTON0_PUSHED || serial_input == ' ') && is_game_pause == 0 
+				&& !computer_to_move) {
+			abandon_computer_search(&computer_thinking);
 			place_a_piece();
 		}
 
+		// take back the last move or play it again. Against the computer
+		// its reply is taken back (or played again) too, so that it is
+		// red's turn afterwards
+		if ((serial_input == 'u' || serial_input == 'U') && is_game_pause == 0) {
+			abandon_computer_search(&computer_thinking);
+			while (undo_move() && is_computer_game && get_current_player() == PLAYER_2) {
+				;
+			}
+		}
+		if ((serial_input == 'r' || serial_input == 'R') && is_game_pause == 0) {
+			abandon_computer_search(&computer_thinking);
+			while (redo_move() && is_computer_game && get_current_player() == PLAYER_2) {
+				;
+			}
+		}
+
+		// show or hide the legal squares for the player to move
+		if ((serial_input == 'h' || serial_input == 'H') && is_game_pause == 0) {
+			toggle_move_hints();
+		}
+
+		// switch the computer opponent on or off (it searches bitboards, so
+		// is only available on boards which fit in one)
+		if ((serial_input == 'c' || serial_input == 'C') && is_game_pause == 0 &&
+				BOARD_FITS_BITBOARD) {
+			is_computer_game = 1 - is_computer_game;
+			abandon_computer_search(&computer_thinking);
+		}
+
+		// let the computer think for a few nodes at a time so the rest of
+		// this loop (cursor, joystick, countdown) keeps running. Whose turn
+		// it is may have changed above, so it is looked at again
+		remote_update();
+		computer_to_move = is_computer_game && get_current_player() == PLAYER_2;
+		if (!computer_to_move) {
+			abandon_computer_search(&computer_thinking);
+		}
+		if (computer_to_move && is_game_pause == 0 && !remote_analysis_running()) {
+			if (!computer_thinking) {
+#if BOARD_FITS_BITBOARD
+				Position position;
+				get_board_position(&position);
+				ai_start_level_search(position.p2, position.p1);
+				computer_search_id = ai_search_id();
+#endif
+				computer_thinking = 1;
+			} else if (ai_search_id() != computer_search_id) {
+				// remote control has used the search for an analysis
+				// since, so start again
+				computer_thinking = 0;
+			} else if (ai_search_step(AI_NODES_PER_STEP)) {
+				computer_thinking = 0;
+				// (no move if the search was abandoned, e.g. by a remote
+				// command changing the board, it starts again next time)
+				uint8_t move = ai_best_move();
+				if (move != AI_NO_MOVE &&
+						is_legal_move(BITBOARD_SQUARE_X(move), BITBOARD_SQUARE_Y(move))) {
+					place_piece_at(BITBOARD_SQUARE_X(move), BITBOARD_SQUARE_Y(move));
+				}
+			}
+		}
+
 		// switch between timed game and none timed game
 		if ((serial_input == 't' || serial_input == 'T') && is_game_pause == 0) {
 			if (is_timed_game == 0) {
@@ -180,6 +363,10 @@ void play_game(void) {
 		
 		
 		led_turn_display();
+		animation_update();
+		update_terminal_board();
+		serial_flush_pending();
+		save_update();
 		if (is_game_pause == 0) {
 			movement_control();
 		}
@@ -220,17 +407,41 @@ void play_game(void) {
 			}
 		}
 	}
+	abandon_computer_search(&computer_thinking);
 	// We get here if the game is over.
 }
 
 void handle_game_over() {
+	save_game_over();
 	move_terminal_cursor(10,14);
 	printf_P(PSTR("GAME OVER"));
 	move_terminal_cursor(10,15);
-	printf_P(PSTR("Press a button to start again"));
+	printf_P(PSTR("Press a button to start again (u/r to review)"));
+	move_terminal_cursor(10,16);
+	printf_P(PSTR("Longest computer step: %d ms"), ai_max_step_time());
+	SerialStats serial_stats;
+	serial_get_stats(&serial_stats);
+	move_terminal_cursor(10,17);
+	printf_P(PSTR("Serial stalls: %u  dropped: %u  coalesced: %u"), 
+			serial_stats.stalls, serial_stats.dropped_bytes, 
+			serial_stats.coalesced_writes);
+	sram_end_phase(SRAM_PHASE_GAME);
+	sram_report(18);
 	
+	// the finished game can be stepped back through with 'u' and
+	// forward again with 'r' while waiting
 	while(button_pushed() == NO_BUTTON_PUSHED) {
-		; // wait
+		int16_t serial_input = remote_read_input();
+		if (serial_input == 'u' || serial_input == 'U') {
+			undo_move();
+		} else if (serial_input == 'r' || serial_input == 'R') {
+			redo_move();
+		}
+		animation_update();
+		update_terminal_board();
+		serial_flush_pending();
+		save_update();
 	}
+	sram_end_phase(SRAM_PHASE_GAME_OVER);
 	
 }
@@ -0,0 +1,489 @@
+/*
+ * remote.c
+ *
+ * Handles remote control frames arriving on the serial port. See remote.h
+ * for the commands. Text command lines (starting with ':') are handled
+ * here too.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "remote.h"
+#include "serialio.h"
+#include "game.h"
+#include "display.h"
+#include "bitboard.h"
+#include "position.h"
+#include "ai.h"
+#include "timer0.h"
+#include "terminalio.h"
+#include "profile.h"
+#include "trace.h"
+#include "sram.h"
+
+// a frame that has been silent for this long (in ms) is abandoned, so a
+// stray sync byte can't swallow the keyboard input that follows it
+#define FRAME_TIMEOUT 100
+
+// ':m' moves which come less than this long (in ms) after the one before
+// are taken to be a game being pasted in. They are played without drawing
+// anything, and the board is drawn once the moves stop (see
+// begin_replay()), so the game loop keeps up with the serial port
+#define STREAM_TIMEOUT 100
+
+static uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD];
+static uint8_t reply_length;
+
+// the game loop doesn't start a search of its own while an analysis is
+// running, or abort one (see ai_search_id()), so the search stays the
+// analysis until it finishes
+static uint8_t analysis_running;
+static uint8_t analysis_sequence;
+
+// what the game loop last said, see remote_set_game_state()
+static uint8_t game_paused;
+static uint8_t computer_to_move;
+static uint32_t last_frame_byte_time;
+
+// 1 while streamed ':m' moves are being played without being drawn
+static uint8_t streaming_moves;
+static uint32_t last_move_time;
+
+// terminal row where command line replies and errors are shown, and where
+// the profiler table is printed
+#define COMMAND_REPLY_ROW 22
+#define PROFILE_REPORT_ROW 24
+
+// 1 while the characters of a ':' command line are being collected
+static uint8_t in_command_line;
+
+// baud rate to change to once the current reply has gone, 0 if none
+static long pending_baud;
+
+#ifdef TRACE
+// 1 if the trace ring should be sent once the current reply has gone
+static uint8_t pending_trace_dump;
+#endif
+
+// the host is about to change the board. A search the game loop has going
+// for the computer opponent would be for a position which is gone (an
+// analysis the host asked for is its own business)
+static void board_changing(void) {
+	if (ai_is_searching() && !analysis_running) {
+		ai_abort();
+	}
+}
+
+static void reply_byte(uint8_t byte) {
+	reply[reply_length++] = byte;
+}
+
+static void reply_number(uint32_t value, uint8_t bytes) {
+	for (uint8_t i = 0; i < bytes; i++) {
+		reply_byte((uint8_t)value);
+		value >>= 8;
+	}
+}
+
+#if BOARD_FITS_BITBOARD
+static void reply_bitboard(BitBoard b) {
+	for (uint8_t i = 0; i < 8; i++) {
+		reply_byte((uint8_t)b);
+		b >>= 8;
+	}
+}
+
+// the current position from the point of view of the player to move
+static void get_own_and_opponent(BitBoard* own, BitBoard* opp) {
+	Position position;
+	get_board_position(&position);
+	if (get_current_player() == PLAYER_1) {
+		*own = position.p1;
+		*opp = position.p2;
+	} else {
+		*own = position.p2;
+		*opp = position.p1;
+	}
+}
+#endif
+
+// run the command at the start of 'args' (which has 'length' bytes after the
+// command byte), adding its reply. Returns the number of argument bytes
+// used, or -1 if the rest of the frame can't be understood
+static int8_t run_command(uint8_t command, const uint8_t* args, uint8_t length) {
+	reply_byte(command);
+	switch (command) {
+#if BOARD_FITS_BITBOARD
+		case REMOTE_SET_POSITION: {
+			if (length < POSITION_BYTES + 1) {
+				break;
+			}
+			Position position;
+			position_unpack(&position, args);
+			uint8_t player = args[POSITION_BYTES];
+			// a position where neither side can move is a finished game,
+			// which there is nothing to do with
+			if ((position.p1 & position.p2) || (player != PLAYER_1 && player != PLAYER_2) ||
+					game_paused || (bitboard_legal_moves(position.p1, position.p2) == 0 &&
+					bitboard_legal_moves(position.p2, position.p1) == 0)) {
+				reply_byte(REMOTE_ILLEGAL);
+			} else {
+				board_changing();
+				set_board_position(&position, player);
+				reply_byte(REMOTE_OK);
+			}
+			return POSITION_BYTES + 1;
+		}
+		case REMOTE_MAKE_MOVE: {
+			if (length < 1) {
+				break;
+			}
+			uint8_t square = args[0];
+			if (square >= 64 || !is_legal_move(BITBOARD_SQUARE_X(square),
+					BITBOARD_SQUARE_Y(square)) || game_paused || computer_to_move) {
+				reply_byte(REMOTE_ILLEGAL);
+			} else {
+				board_changing();
+				place_piece_at(BITBOARD_SQUARE_X(square), BITBOARD_SQUARE_Y(square));
+				reply_byte(REMOTE_OK);
+			}
+			return 1;
+		}
+		case REMOTE_LEGAL_MOVES: {
+			BitBoard own, opp;
+			get_own_and_opponent(&own, &opp);
+			reply_byte(REMOTE_OK);
+			reply_bitboard(bitboard_legal_moves(own, opp));
+			return 0;
+		}
+		case REMOTE_SCORES: {
+			Position position;
+			get_board_position(&position);
+			reply_byte(REMOTE_OK);
+			reply_byte(bitboard_count(position.p1));
+			reply_byte(bitboard_count(position.p2));
+			reply_byte(get_current_player());
+			return 0;
+		}
+		case REMOTE_POSITION_KEY: {
+			Position position, canonical;
+			get_board_position(&position);
+			reply_byte(REMOTE_OK);
+			reply_number(position_key(&position, get_current_player()), 4);
+			reply_byte(position_canonical(&position, &canonical));
+			return 0;
+		}
+		case REMOTE_ANALYSE:
+			if (length < 1) {
+				break;
+			}
+			if (analysis_running || ai_is_searching()) {
+				reply_byte(REMOTE_BUSY);
+			} else {
+				BitBoard own, opp;
+				get_own_and_opponent(&own, &opp);
+				if (args[0] == 0) {
+					ai_start_level_search(own, opp);
+				} else {
+					ai_start_search(own, opp, args[0]);
+				}
+				analysis_running = 1;
+				analysis_sequence = serial_frame_sequence();
+				reply_byte(REMOTE_OK);
+			}
+			return 1;
+#endif
+		case REMOTE_SET_LEVEL:
+			if (length < 1) {
+				break;
+			}
+			if (analysis_running || ai_is_searching()) {
+				reply_byte(REMOTE_BUSY);
+			} else if (ai_set_level(args[0])) {
+				reply_byte(REMOTE_OK);
+			} else {
+				reply_byte(REMOTE_ILLEGAL);
+			}
+			return 1;
+		case REMOTE_SET_BAUD: {
+			if (length < 4) {
+				break;
+			}
+			long baud = args[0] | ((long)args[1] << 8) | ((long)args[2] << 16) 
+					| ((long)args[3] << 24);
+			uint16_t ubrr;
+			uint8_t double_speed;
+			int16_t error = serial_baud_error(baud, &ubrr, &double_speed);
+			if (baud <= 0 || error > SERIAL_MAX_BAUD_ERROR || error < -SERIAL_MAX_BAUD_ERROR) {
+				reply_byte(REMOTE_ILLEGAL);
+			} else {
+				pending_baud = baud;
+				reply_byte(REMOTE_OK);
+			}
+			return 4;
+		}
+		case REMOTE_SELF_TEST: {
+			SerialSelfTest result;
+			serial_self_test(&result);
+			reply_byte(REMOTE_OK);
+			reply_number(result.bytes_per_second, 4);
+			reply_number(result.isr_load_permille, 2);
+			reply_number(result.isr_ns_per_byte, 2);
+			return 0;
+		}
+		case REMOTE_TRACE_DUMP:
+#ifdef TRACE
+			pending_trace_dump = 1;
+			reply_byte(REMOTE_OK);
+#else
+			reply_byte(REMOTE_ILLEGAL);
+#endif
+			return 0;
+	}
+	reply_byte(REMOTE_BAD_COMMAND);
+	return -1;
+}
+
+#ifdef TRACE
+// send the whole trace ring as REMOTE_TRACE_DATA frames
+static void send_trace(uint8_t sequence) {
+	TraceRecord records[(SERIAL_FRAME_MAX_PAYLOAD - 2) / TRACE_RECORD_BYTES];
+	uint8_t count;
+	do {
+		count = trace_read(records, sizeof(records) / sizeof(records[0]));
+		reply_length = 0;
+		reply_byte(REMOTE_TRACE_DATA);
+		reply_byte(count);
+		for (uint8_t i = 0; i < count; i++) {
+			reply_number(records[i].time, 4);
+			reply_byte(records[i].type);
+			reply_byte(records[i].arg);
+		}
+		serial_frame_send(sequence, reply, reply_length);
+	} while (count > 0);
+}
+#endif
+
+// run every command in the frame just received and send the reply
+static void handle_frame(void) {
+	uint8_t length;
+	const uint8_t* payload = serial_frame_payload(&length);
+	uint8_t sequence = serial_frame_sequence();
+	reply_length = 0;
+	uint8_t i = 0;
+	while (i < length) {
+		if (reply_length + REMOTE_MAX_REPLY > SERIAL_FRAME_MAX_PAYLOAD) {
+			reply_byte(payload[i]);
+			reply_byte(REMOTE_NO_ROOM);
+			break;
+		}
+		int8_t used = run_command(payload[i], payload + i + 1, length - i - 1);
+		if (used < 0) {
+			break;
+		}
+		i += 1 + used;
+	}
+	serial_frame_send(sequence, reply, reply_length);
+	if (pending_baud) {
+		(void)serial_set_baud_rate(pending_baud);
+		pending_baud = 0;
+	}
+#ifdef TRACE
+	if (pending_trace_dump) {
+		send_trace(sequence);
+		pending_trace_dump = 0;
+	}
+#endif
+}
+
+static void print_square(uint8_t x, uint8_t y) {
+	serial_put_char('a' + x);
+	terminal_print_number(y + 1, 0);
+}
+
+// draws the board streamed moves have left, if there were any
+static void end_streaming(void) {
+	if (streaming_moves) {
+		streaming_moves = 0;
+		end_replay();
+	}
+}
+
+// number of pieces 'player' has on the board
+static uint16_t count_pieces(uint8_t player) {
+	uint16_t count = 0;
+	for (uint8_t x = 0; x < WIDTH; x++) {
+		for (uint8_t y = 0; y < HEIGHT; y++) {
+			if (get_piece_at(x, y) == player) {
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+// run the command line just collected. Commands are
+//		m <square>	place a piece, squares are a1 (bottom left) to h8 (on an
+//					8x8 board)
+//		h			turn move hints on or off
+//		l			list the legal moves
+//		s			show the scores
+//		p			print the profiler table (p 0 clears it), if compiled in
+//		r			show the SRAM headroom
+//		c [level]	show or set the computer opponent's level
+// Nothing is printed for a successful move, and moves which come in
+// quickly aren't drawn until they stop, so that a whole game's moves can
+// be streamed in without the input buffer overrunning
+static void run_command_line(uint8_t status) {
+	const char* command = serial_line_token(0);
+	uint8_t count = serial_line_token_count();
+
+	if (status == SERIAL_LINE_READY && command[0] == 'm' && count == 2) {
+		const char* name = serial_line_token(1);
+		uint8_t x = name[0] - 'a';
+		// rows can have one or two digits
+		uint8_t y = name[1] - '0';
+		if (name[1] != '\0' && name[2] != '\0') {
+			y = y * 10 + (name[2] - '0');
+		}
+		y--;
+		if (name[1] != '\0' && (name[2] == '\0' || name[3] == '\0') &&
+				is_legal_move(x, y) && !game_paused && !computer_to_move) {
+			board_changing();
+			uint32_t now = get_current_time();
+			if (!streaming_moves && now - last_move_time < STREAM_TIMEOUT) {
+				streaming_moves = 1;
+				begin_replay();
+			}
+			last_move_time = now;
+			place_piece_at(x, y);
+			if (is_game_over()) {
+				// the game loop is about to finish
+				end_streaming();
+			}
+			return;
+		}
+	} else if (status == SERIAL_LINE_READY && command[0] == 'h' && count == 1) {
+		toggle_move_hints();
+		return;
+	}
+
+	move_terminal_cursor(10, COMMAND_REPLY_ROW);
+	clear_to_end_of_line();
+	if (status == SERIAL_LINE_TOO_LONG) {
+		terminal_print_P(PSTR("Line too long"));
+	} else if (command[0] == 'm' && (game_paused || computer_to_move)) {
+		if (game_paused) {
+			terminal_print_P(PSTR("Game paused"));
+		} else {
+			terminal_print_P(PSTR("Computer's turn"));
+		}
+	} else if (command[0] == 'm') {
+		terminal_print_P(PSTR("Illegal move:"));
+		for (uint8_t i = 0; i < count; i++) {
+			const char* token = serial_line_token(i);
+			serial_put_char(' ');
+			while (*token) {
+				serial_put_char(*token++);
+			}
+		}
+	} else if (command[0] == 'l' && count == 1) {
+		terminal_print_P(PSTR("Legal moves:"));
+		for (uint8_t y = 0; y < HEIGHT; y++) {
+			for (uint8_t x = 0; x < WIDTH; x++) {
+				if (is_legal_move(x, y)) {
+					serial_put_char(' ');
+					print_square(x, y);
+				}
+			}
+		}
+#ifdef PROFILE
+	} else if (command[0] == 'p') {
+		if (count == 2) {
+			profile_reset();
+			terminal_print_P(PSTR("Profile cleared"));
+		} else {
+			profile_report(PROFILE_REPORT_ROW);
+		}
+#endif
+	} else if (command[0] == 'r' && count == 1) {
+		sram_report(COMMAND_REPLY_ROW);
+	} else if (command[0] == 'c' && count <= 2) {
+		const char* new_level = serial_line_token(1);
+		if (count == 2 && (new_level[1] != '\0' || !ai_set_level(new_level[0] - '0'))) {
+			terminal_print_P(PSTR("Levels are 1 to "));
+			terminal_print_number(AI_NUM_LEVELS, 0);
+		} else {
+			terminal_print_P(PSTR("Computer level "));
+			terminal_print_number(ai_get_level(), 0);
+		}
+	} else if (command[0] == 's' && count == 1) {
+		terminal_print_P(PSTR("Red "));
+		terminal_print_number(count_pieces(PLAYER_1), 0);
+		terminal_print_P(PSTR(" Green "));
+		terminal_print_number(count_pieces(PLAYER_2), 0);
+	} else {
+		terminal_print_P(PSTR("Unknown command"));
+	}
+}
+
+int16_t remote_read_input(void) {
+	if (serial_frame_active() &&
+			get_current_time() - last_frame_byte_time > FRAME_TIMEOUT) {
+		serial_frame_reset();
+	}
+	if (streaming_moves && get_current_time() - last_move_time > STREAM_TIMEOUT) {
+		end_streaming();
+	}
+	int16_t c;
+	while ((c = serial_read_byte()) >= 0) {
+		if (in_command_line) {
+			uint8_t status = serial_line_receive(c);
+			if (status != SERIAL_LINE_INCOMPLETE) {
+				in_command_line = 0;
+				run_command_line(status);
+			}
+			continue;
+		}
+		if (c == ':' && !serial_frame_active()) {
+			in_command_line = 1;
+			continue;
+		}
+		if (!serial_frame_active() && c != SERIAL_FRAME_SYNC) {
+			// an ordinary key press, translated the same way as stdin
+			if (c == '\r') {
+				c = '\n';
+			}
+			TRACE_LOG(TRACE_KEY, c);
+			// (the key may well be about the board, e.g. an undo)
+			end_streaming();
+			return c;
+		}
+		last_frame_byte_time = get_current_time();
+		if (serial_frame_receive(c) == SERIAL_FRAME_READY) {
+			end_streaming();
+			handle_frame();
+		}
+	}
+	return -1;
+}
+
+void remote_update(void) {
+	if (analysis_running && ai_search_step(AI_NODES_PER_STEP)) {
+		uint8_t result[3] = { REMOTE_ANALYSIS_RESULT, REMOTE_OK, ai_best_move() };
+		serial_frame_send(analysis_sequence, result, 3);
+		analysis_running = 0;
+	}
+}
+
+void remote_set_game_state(uint8_t paused, uint8_t computers_turn) {
+	game_paused = paused;
+	computer_to_move = computers_turn;
+}
+
+uint8_t remote_analysis_running(void) {
+	return analysis_running;
+}
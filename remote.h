@@ -0,0 +1,95 @@
+/*
+ * remote.h
+ *
+ * Remote control of the game over the serial port using binary frames
+ * (see serialio.h for the frame format). This header is shared with the
+ * host side client in host/ so it must only depend on stdint.h.
+ *
+ * A frame's payload holds one or more commands back to back. Each command
+ * is a command byte followed by its arguments. The reply is a frame with
+ * the same sequence number, holding for each command the command byte, a
+ * status byte and any results. If a command is not recognised the reply
+ * stops after its status, since the length of its arguments isn't known.
+ *
+ * Bitboards are sent as 8 bytes, least significant byte (row y = 0) first.
+ * Squares are bitboard square numbers, y * 8 + x. Since positions are sent
+ * as bitboards, commands 0x01 to 0x05 and 0x09 are only available when the
+ * board fits in one (see board.h) and are answered with REMOTE_BAD_COMMAND
+ * otherwise.
+ */
+
+#ifndef REMOTE_H_
+#define REMOTE_H_
+
+#include <stdint.h>
+
+// Commands							arguments					results
+#define REMOTE_SET_POSITION	0x01	// p1[8] p2[8] player		-
+#define REMOTE_MAKE_MOVE	0x02	// square					-
+#define REMOTE_LEGAL_MOVES	0x03	// -						moves[8]
+#define REMOTE_SCORES		0x04	// -						p1 p2 player
+#define REMOTE_ANALYSE		0x05	// depth					-
+#define REMOTE_SET_BAUD		0x06	// baud[4]					-
+#define REMOTE_SELF_TEST	0x07	// -						bytes/s[4] load[2] ns[2]
+#define REMOTE_TRACE_DUMP	0x08	// -						-
+#define REMOTE_POSITION_KEY	0x09	// -						key[4] symmetry
+#define REMOTE_SET_LEVEL	0x0A	// level					-
+
+// REMOTE_SET_POSITION and REMOTE_MAKE_MOVE abandon any search the computer
+// opponent has started (see remote_set_game_state() for when they are
+// refused). REMOTE_SET_POSITION refuses a position where neither player
+// can move; if just 'player' can't, the other player is to move.
+// REMOTE_SET_BAUD changes the rate after its reply has been sent (at the
+// old rate). Multi-byte numbers are least significant byte first.
+// REMOTE_POSITION_KEY gives position_key() for the current position and
+// the symmetry which turns it into its canonical form (see position.h).
+// REMOTE_ANALYSE with a depth of 0 searches as the computer opponent does,
+// at the level set by REMOTE_SET_LEVEL (see ai.h), so the host can check
+// that it picks the same move as a host build.
+
+// When an analysis finishes the device sends a frame of its own, with the
+// sequence number of the REMOTE_ANALYSE request, holding
+//		REMOTE_ANALYSIS_RESULT, status, best square
+#define REMOTE_ANALYSIS_RESULT	0x85
+
+// After the reply to REMOTE_TRACE_DUMP the device sends the events in its
+// trace ring (see trace.h), oldest first, in frames with the same sequence
+// number holding
+//		REMOTE_TRACE_DATA, count, count records of TRACE_RECORD_BYTES each
+// and finishes with a frame with a count of 0. The events sent are removed
+// from the ring. If tracing isn't compiled in the status is REMOTE_ILLEGAL
+#define REMOTE_TRACE_DATA		0x88
+
+// Status bytes
+#define REMOTE_OK			0x00
+#define REMOTE_ILLEGAL		0x01	// move or position not allowed
+#define REMOTE_BUSY			0x02	// an analysis is already running
+#define REMOTE_BAD_COMMAND	0x03	// unknown command or arguments missing
+#define REMOTE_NO_ROOM		0x04	// reply frame full, command not run
+
+// Most bytes a single command's reply can take
+#define REMOTE_MAX_REPLY	10
+
+// Device side functions
+
+// Reads the waiting serial input, running any remote control frames and
+// ':' command lines (see remote.c) in it.
+// Returns the next ordinary character (e.g. a key press), or -1 if there
+// isn't one. Use this instead of reading stdin directly
+int16_t remote_read_input(void);
+
+// Continues an analysis requested by the host (a few nodes at a time) and
+// sends the result when it finishes. Call each time through the game loop
+void remote_update(void);
+
+// returns 1 if the search is being used for an analysis requested by the host
+uint8_t remote_analysis_running(void);
+
+// tells remote control whether the game is paused and whether it is the
+// computer opponent's turn. The host can't play a move (REMOTE_MAKE_MOVE or
+// ':m') in either case, or set a position while the game is paused; those
+// commands are answered with REMOTE_ILLEGAL. Call before remote_read_input()
+// each time through the game loop
+void remote_set_game_state(uint8_t paused, uint8_t computers_turn);
+
+#endif /* REMOTE_H_ */
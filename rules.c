@@ -0,0 +1,166 @@
+/*
+ * rules.c
+ *
+ * Square by square move generation for any board size. See rules.h.
+ *
+ * Boards which fit in a bitboard use it where whole-board answers are
+ * needed (does the player have any move at all?), since that is much
+ * quicker than trying every square.
+ */
+
+#include <stdint.h>
+
+#include "rules.h"
+#include "display.h"
+
+// step in x and y for each direction
+static const int8_t direction_dx[RULES_NUM_DIRECTIONS] = { -1, 0, 1, 1, 1, 0, -1, -1 };
+static const int8_t direction_dy[RULES_NUM_DIRECTIONS] = { 1, 1, 1, 0, -1, -1, -1, 0 };
+
+uint8_t rules_step(uint8_t* x, uint8_t* y, uint8_t direction) {
+	// stepping off the left or bottom edge wraps round to 255, so one
+	// unsigned comparison checks both edges
+	*x += direction_dx[direction];
+	*y += direction_dy[direction];
+	return *x < BOARD_WIDTH && *y < BOARD_HEIGHT;
+}
+
+uint8_t rules_flip_directions(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT],
+		uint8_t x, uint8_t y, uint8_t player) {
+	if (board[x][y] != EMPTY_SQUARE) {
+		return 0;
+	}
+	uint8_t opponent = RULES_OPPONENT(player);
+	uint8_t directions = 0;
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		uint8_t px = x;
+		uint8_t py = y;
+		// there has to be at least one opponent disc next to the square,
+		// then a run of them ended by one of ours
+		if (!rules_step(&px, &py, d) || board[px][py] != opponent) {
+			continue;
+		}
+		while (rules_step(&px, &py, d)) {
+			uint8_t piece = board[px][py];
+			if (piece == player) {
+				directions |= (1 << d);
+			}
+			if (piece != opponent) {
+				break;
+			}
+		}
+	}
+	return directions;
+}
+
+uint8_t rules_make_move(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT],
+		uint8_t x, uint8_t y, uint8_t player, uint8_t directions) {
+	uint8_t flipped = 0;
+	board[x][y] = player;
+	for (uint8_t d = 0; d < RULES_NUM_DIRECTIONS; d++) {
+		if (!(directions & (1 << d))) {
+			continue;
+		}
+		uint8_t px = x;
+		uint8_t py = y;
+		while (rules_step(&px, &py, d) && board[px][py] != player) {
+			board[px][py] = player;
+			flipped++;
+		}
+	}
+	return flipped;
+}
+
+#if BOARD_FITS_BITBOARD
+
+void rules_to_position(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], Position* position) {
+	BitBoard p1_discs = 0;
+	BitBoard p2_discs = 0;
+	// build each row as a byte and shift whole rows in, rather than shifting
+	// a bit into place for every square (64 bit shifts are slow on the AVR)
+	for (int8_t y = BOARD_HEIGHT - 1; y >= 0; y--) {
+		uint8_t p1_row = 0;
+		uint8_t p2_row = 0;
+		for (int8_t x = BOARD_WIDTH - 1; x >= 0; x--) {
+			p1_row <<= 1;
+			p2_row <<= 1;
+			if (board[x][y] == PLAYER_1) {
+				p1_row |= 1;
+			} else if (board[x][y] == PLAYER_2) {
+				p2_row |= 1;
+			}
+		}
+		p1_discs = (p1_discs << 8) | p1_row;
+		p2_discs = (p2_discs << 8) | p2_row;
+	}
+	position->p1 = p1_discs;
+	position->p2 = p2_discs;
+}
+
+void rules_from_position(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], const Position* position) {
+	BitBoard p1_discs = position->p1;
+	BitBoard p2_discs = position->p2;
+	for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+		uint8_t p1_row = (uint8_t)p1_discs;
+		uint8_t p2_row = (uint8_t)p2_discs;
+		for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+			if (p1_row & 1) {
+				board[x][y] = PLAYER_1;
+			} else if (p2_row & 1) {
+				board[x][y] = PLAYER_2;
+			} else {
+				board[x][y] = EMPTY_SQUARE;
+			}
+			p1_row >>= 1;
+			p2_row >>= 1;
+		}
+		p1_discs >>= 8;
+		p2_discs >>= 8;
+	}
+}
+
+// legal moves for 'player' found all at once from the bitboards
+static BitBoard legal_moves(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player) {
+	Position position;
+	rules_to_position(board, &position);
+	if (player == PLAYER_1) {
+		return bitboard_legal_moves(position.p1, position.p2);
+	} else {
+		return bitboard_legal_moves(position.p2, position.p1);
+	}
+}
+
+uint8_t rules_has_legal_move(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player) {
+	return legal_moves(board, player) != 0;
+}
+
+uint8_t rules_count_legal_moves(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player) {
+	return bitboard_count(legal_moves(board, player));
+}
+
+#else
+
+uint8_t rules_has_legal_move(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player) {
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if (rules_flip_directions(board, x, y, player)) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+uint8_t rules_count_legal_moves(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player) {
+	uint8_t count = 0;
+	for (uint8_t x = 0; x < BOARD_WIDTH; x++) {
+		for (uint8_t y = 0; y < BOARD_HEIGHT; y++) {
+			if (rules_flip_directions(board, x, y, player)) {
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+#endif /* BOARD_FITS_BITBOARD */
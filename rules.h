@@ -0,0 +1,53 @@
+/*
+ * rules.h
+ *
+ * The rules of Reversi, worked out square by square on a board array of
+ * any size allowed by board.h. This doesn't touch the display or any
+ * hardware, so it can be built on a host as well (see host/board_bench.c).
+ *
+ * The board is indexed board[x][y] and holds EMPTY_SQUARE, PLAYER_1 or
+ * PLAYER_2 (see display.h).
+ */
+
+#ifndef RULES_H_
+#define RULES_H_
+
+#include <stdint.h>
+
+#include "board.h"
+#include "bitboard.h"
+#include "position.h"
+
+#define RULES_NUM_DIRECTIONS 8
+
+// the other player
+#define RULES_OPPONENT(player) (3 - (player))
+
+// Returns the directions in which a disc placed on (x, y) by 'player'
+// would flip discs, as bit d for direction d. 0 means the move is illegal
+// (including when the square is not empty)
+uint8_t rules_flip_directions(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT],
+		uint8_t x, uint8_t y, uint8_t player);
+
+// moves (*x, *y) one square in 'direction'. Returns 0 if that would leave
+// the board (in which case *x or *y is no longer a board square)
+uint8_t rules_step(uint8_t* x, uint8_t* y, uint8_t direction);
+
+// places a disc for 'player' on (x, y) and flips the discs in each of
+// 'directions' (from rules_flip_directions()). Returns the number flipped
+uint8_t rules_make_move(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT],
+		uint8_t x, uint8_t y, uint8_t player, uint8_t directions);
+
+// returns 1 if 'player' has at least one legal move
+uint8_t rules_has_legal_move(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player);
+
+// returns the number of legal moves 'player' has
+uint8_t rules_count_legal_moves(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], uint8_t player);
+
+#if BOARD_FITS_BITBOARD
+// converts between the board array and a Position
+void rules_to_position(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], Position* position);
+void rules_from_position(uint8_t board[BOARD_WIDTH][BOARD_HEIGHT], const Position* position);
+#endif
+
+#endif /* RULES_H_ */
@@ -0,0 +1,373 @@
+/*
+ * save.c
+ *
+ * EEPROM game log. See save.h.
+ *
+ * Each record is 4 bytes:
+ *		(lap << 6) | type, data 0, data 1, CRC-8 of the first three
+ * The lap number (0 to 2) goes up by one each time the log wraps round,
+ * so the end of the log is where the lap number changes. Erased EEPROM
+ * reads as 0xFF, i.e. lap 3, which no record ever has.
+ */
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+
+#include "save.h"
+#include "game.h"
+#include "display.h"
+
+#define RECORD_BYTES	4
+#define NUM_RECORDS		((E2END + 1) / RECORD_BYTES)
+#define NUM_LAPS		3
+#define ERASED_LAP		3
+#define LAP_SHIFT		6
+#define TYPE_MASK		0x3F
+
+// record types					data 0			data 1
+#define RECORD_GAME_START	1	// board width	board height
+#define RECORD_MOVE			2	// (y << 4) | x	flags
+#define RECORD_POSITION		3	// player		flags
+#define RECORD_POSITION_DATA 4	// two bytes of the packed position
+#define RECORD_GAME_OVER	5	// -			-
+#define RECORD_UNDO			6	// -			-
+
+#define MOVE_TIMED 0x01
+
+// number of RECORD_POSITION_DATA records after a RECORD_POSITION
+#define POSITION_DATA_RECORDS (POSITION_BYTES / 2)
+#define POSITION_QUEUE_BYTES ((POSITION_DATA_RECORDS + 1) * RECORD_BYTES)
+
+// where the next record will go and the lap number it will have
+static uint16_t next_record;
+static uint8_t lap;
+
+// first record of the unfinished game at the end of the log, if any
+static uint16_t resume_record;
+static uint8_t game_available;
+
+// set while a game is being played (not while a saved one is being
+// replayed, or after it has finished and is just being looked back over)
+static uint8_t saving;
+
+// Bytes waiting to be written. They always go to consecutive addresses, so
+// only the address of the next one is needed. There is room for a whole
+// position (POSITION_DATA_RECORDS + 1 records) and a few moves after it
+#define QUEUE_SIZE 64
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+static uint8_t queue[QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static uint16_t write_address;
+
+// What save_update() has to write once there is room in the queue, after
+// records were left out because it was full (see write_record())
+#define CATCH_UP_NONE		0
+#define CATCH_UP_POSITION	1	// the whole board
+#define CATCH_UP_GAME_OVER	2
+static uint8_t catch_up;
+static uint8_t catch_up_flags;
+
+// CRC-8, polynomial x^8 + x^2 + x + 1
+static uint8_t crc8(const uint8_t* data, uint8_t length) {
+	uint8_t crc = 0;
+	while (length--) {
+		crc ^= *data++;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+static void read_record(uint16_t index, uint8_t* record) {
+	const uint8_t* address = (const uint8_t*)(index * RECORD_BYTES);
+	for (uint8_t i = 0; i < RECORD_BYTES; i++) {
+		record[i] = eeprom_read_byte(address + i);
+	}
+}
+
+static uint8_t record_lap(uint16_t index) {
+	return eeprom_read_byte((const uint8_t*)(index * RECORD_BYTES)) >> LAP_SHIFT;
+}
+
+static uint8_t record_valid(const uint8_t* record) {
+	return (record[0] >> LAP_SHIFT) != ERASED_LAP &&
+			crc8(record, RECORD_BYTES - 1) == record[RECORD_BYTES - 1];
+}
+
+static uint16_t previous_record(uint16_t index) {
+	return (index == 0) ? NUM_RECORDS - 1 : index - 1;
+}
+
+static uint16_t following_record(uint16_t index) {
+	return (index == NUM_RECORDS - 1) ? 0 : index + 1;
+}
+
+void init_save(void) {
+	queue_head = 0;
+	queue_tail = 0;
+	catch_up = CATCH_UP_NONE;
+	game_available = 0;
+
+	// find the end of the log: the first record after the first valid one
+	// whose lap differs from it. Record 0 isn't simply taken as the start,
+	// as a reset while it was being written at the start of a new lap
+	// leaves it erased or half written with the last lap still after it
+	uint8_t record[RECORD_BYTES];
+	uint16_t first = 0;
+	read_record(first, record);
+	while (!record_valid(record) && ++first < NUM_RECORDS) {
+		read_record(first, record);
+	}
+	lap = 0;
+	next_record = 0;
+	if (first < NUM_RECORDS) {
+		lap = record_lap(first);
+		next_record = first + 1;
+		while (next_record < NUM_RECORDS && record_lap(next_record) == lap) {
+			next_record++;
+		}
+		if (next_record == NUM_RECORDS) {
+			// the log filled to the end, next time round is a new lap
+			// (which starts by writing over any bad records at the start)
+			next_record = 0;
+			lap = (lap + 1) % NUM_LAPS;
+		}
+	}
+	// (otherwise nothing valid has ever been saved)
+
+	// the last record may have been cut short by the reset, if so it
+	// will be written over
+	uint16_t last = previous_record(next_record);
+	read_record(last, record);
+	if (record_lap(last) != ERASED_LAP && !record_valid(record)) {
+		if (next_record == 0) {
+			lap = (lap + NUM_LAPS - 1) % NUM_LAPS;
+		}
+		next_record = last;
+	}
+	write_address = next_record * RECORD_BYTES;
+
+	// Walk back to the start of the last game. A bad record on the way
+	// means there is nothing sensible to resume
+	uint16_t index = next_record;
+	for (uint16_t i = 0; i < NUM_RECORDS; i++) {
+		index = previous_record(index);
+		read_record(index, record);
+		if (!record_valid(record)) {
+			return;
+		}
+		uint8_t type = record[0] & TYPE_MASK;
+		if (type == RECORD_GAME_OVER) {
+			return;
+		}
+		if (type == RECORD_POSITION ||
+				(type == RECORD_GAME_START && record[1] == WIDTH && record[2] == HEIGHT)) {
+			resume_record = index;
+			game_available = 1;
+			return;
+		}
+		if (type == RECORD_GAME_START) {
+			// saved by a build with a different board size
+			return;
+		}
+	}
+}
+
+uint8_t save_game_available(void) {
+	return game_available;
+}
+
+static uint8_t queue_space(void) {
+	return QUEUE_SIZE - (uint8_t)(queue_head - queue_tail);
+}
+
+// queue a record to be written at the end of the log
+static void write_record(uint8_t type, uint8_t data0, uint8_t data1) {
+#if BOARD_FITS_BITBOARD
+	// Moves can come in faster than the EEPROM takes them (e.g. a game
+	// pasted in over the serial port). Rather than wait, the records are
+	// left out and save_update() writes the whole board once there is
+	// room, which replaces them all. Once behind, everything up to then
+	// has to be left out, or the log would be out of order
+	if (catch_up != CATCH_UP_NONE || queue_space() < RECORD_BYTES) {
+		if (type == RECORD_GAME_OVER) {
+			catch_up = CATCH_UP_GAME_OVER;
+		} else {
+			catch_up = CATCH_UP_POSITION;
+			if (type == RECORD_MOVE) {
+				catch_up_flags = data1;
+			}
+		}
+		return;
+	}
+#else
+	// Bigger boards have no position to catch up with, so once a record
+	// has been left out the rest of the game can't be resumed. Its records
+	// are all left out and save_update() ends the game in the log instead.
+	// A new game starts saving again if there is room
+	if (type == RECORD_GAME_START && queue_space() >= RECORD_BYTES) {
+		catch_up = CATCH_UP_NONE;
+	} else if (catch_up != CATCH_UP_NONE || queue_space() < RECORD_BYTES) {
+		catch_up = CATCH_UP_GAME_OVER;
+		return;
+	}
+#endif
+	uint8_t record[RECORD_BYTES] = { (lap << LAP_SHIFT) | type, data0, data1, 0 };
+	record[RECORD_BYTES - 1] = crc8(record, RECORD_BYTES - 1);
+	for (uint8_t i = 0; i < RECORD_BYTES; i++) {
+		queue[queue_head & QUEUE_MASK] = record[i];
+		queue_head++;
+	}
+	EECR |= (1<<EERIE);
+
+	next_record = following_record(next_record);
+	if (next_record == 0) {
+		lap = (lap + 1) % NUM_LAPS;
+	}
+}
+
+// EEPROM ready. Write the next queued byte, or turn this interrupt off
+// if there aren't any
+ISR(EE_READY_vect) {
+	if (queue_tail == queue_head) {
+		EECR &= ~(1<<EERIE);
+		return;
+	}
+	EEAR = write_address;
+	EEDR = queue[queue_tail & QUEUE_MASK];
+	// EEPE has to be set within four cycles of EEMPE, interrupts are
+	// already off in here
+	EECR |= (1<<EEMPE);
+	EECR |= (1<<EEPE);
+	queue_tail++;
+	write_address++;
+	if (write_address > E2END) {
+		write_address = 0;
+	}
+}
+
+uint8_t save_resume(void) {
+	if (!game_available) {
+		return 0;
+	}
+	game_available = 0;
+	uint8_t flags = SAVE_RESUMED;
+	uint8_t record[RECORD_BYTES];
+	uint16_t index = resume_record;
+
+	// the board is only drawn once, at the end
+	begin_replay();
+	while (index != next_record) {
+		read_record(index, record);
+		if (!record_valid(record)) {
+			break;
+		}
+		uint8_t type = record[0] & TYPE_MASK;
+		if (type == RECORD_MOVE) {
+			uint8_t x = record[1] & 0x0F;
+			uint8_t y = record[1] >> 4;
+			if (!is_legal_move(x, y)) {
+				break;
+			}
+			place_piece_at(x, y);
+			flags = SAVE_RESUMED | ((record[2] & MOVE_TIMED) ? SAVE_RESUMED_TIMED : 0);
+		} else if (type == RECORD_UNDO) {
+			undo_move();
+#if BOARD_FITS_BITBOARD
+		} else if (type == RECORD_POSITION) {
+			uint8_t player = record[1];
+			uint8_t position_flags = record[2];
+			uint8_t bytes[POSITION_BYTES];
+			for (uint8_t i = 0; i < POSITION_DATA_RECORDS; i++) {
+				index = following_record(index);
+				read_record(index, record);
+				if (!record_valid(record) || (record[0] & TYPE_MASK) != RECORD_POSITION_DATA) {
+					end_replay();
+					saving = 1;
+					return flags;
+				}
+				bytes[2 * i] = record[1];
+				bytes[2 * i + 1] = record[2];
+			}
+			Position position;
+			position_unpack(&position, bytes);
+			set_board_position(&position, player);
+			flags = SAVE_RESUMED | ((position_flags & MOVE_TIMED) ? SAVE_RESUMED_TIMED : 0);
+#endif
+		}
+		index = following_record(index);
+	}
+	end_replay();
+	saving = 1;
+	return flags;
+}
+
+void save_new_game(void) {
+	game_available = 0;
+	catch_up_flags = 0;
+	write_record(RECORD_GAME_START, WIDTH, HEIGHT);
+	saving = 1;
+}
+
+void save_move(uint8_t x, uint8_t y, uint8_t timed) {
+	if (saving) {
+		write_record(RECORD_MOVE, (y << 4) | x, timed ? MOVE_TIMED : 0);
+	}
+}
+
+#if BOARD_FITS_BITBOARD
+// queue a position record and its data, which there must be room for
+static void write_position(const Position* position, uint8_t player, uint8_t flags) {
+	uint8_t bytes[POSITION_BYTES];
+	position_pack(position, bytes);
+	write_record(RECORD_POSITION, player, flags);
+	for (uint8_t i = 0; i < POSITION_DATA_RECORDS; i++) {
+		write_record(RECORD_POSITION_DATA, bytes[2 * i], bytes[2 * i + 1]);
+	}
+}
+
+void save_position(const Position* position, uint8_t player) {
+	if (!saving) {
+		return;
+	}
+	// half a position can't be resumed, so it all goes or none of it does
+	if (catch_up != CATCH_UP_NONE || queue_space() < POSITION_QUEUE_BYTES) {
+		catch_up = CATCH_UP_POSITION;
+		catch_up_flags = 0;
+		return;
+	}
+	write_position(position, player, 0);
+}
+#endif
+
+void save_undo(void) {
+	if (saving) {
+		write_record(RECORD_UNDO, 0, 0);
+	}
+}
+
+void save_game_over(void) {
+	if (saving) {
+		write_record(RECORD_GAME_OVER, 0, 0);
+		saving = 0;
+	}
+}
+
+void save_update(void) {
+	if (catch_up == CATCH_UP_GAME_OVER && queue_space() >= RECORD_BYTES) {
+		catch_up = CATCH_UP_NONE;
+		write_record(RECORD_GAME_OVER, 0, 0);
+#if BOARD_FITS_BITBOARD
+	} else if (catch_up == CATCH_UP_POSITION && queue_space() >= POSITION_QUEUE_BYTES) {
+		catch_up = CATCH_UP_NONE;
+		Position position;
+		get_board_position(&position);
+		write_position(&position, get_current_player(), catch_up_flags);
+#endif
+	}
+}
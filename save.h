@@ -0,0 +1,68 @@
+/*
+ * save.h
+ *
+ * Saving the game in progress to EEPROM, so that it carries on where it
+ * left off after a reset or power cut.
+ *
+ * The EEPROM is used as one circular log of 4 byte records. A new game
+ * writes a start record and each move appends a record with just the
+ * square played, so saving a move costs 4 bytes rather than a whole board. Taking a move back
+ * appends an undo record.
+ * Because the log goes round the whole EEPROM, every byte is written
+ * equally often (once per 256 records).
+ *
+ * Records are queued in RAM and written a byte at a time by the EEPROM
+ * ready interrupt, so saving never waits the 3.4ms each EEPROM byte takes.
+ * If moves come in faster than that and the queue fills, their records are
+ * left out and save_update() writes the whole board instead once the queue
+ * has room for it. Boards too big for a Position can't do that, so the
+ * game is ended in the log instead and won't be resumed.
+ * Each record has a CRC, so one half written when the power went is
+ * ignored.
+ */
+
+#ifndef SAVE_H_
+#define SAVE_H_
+
+#include <stdint.h>
+
+#include "position.h"
+
+// returned by save_resume()
+#define SAVE_RESUMED		0x01	// a game was resumed
+#define SAVE_RESUMED_TIMED	0x02	// and it was a timed game
+
+// find the end of the log and whether it holds an unfinished game. Call
+// once at startup, before interrupts are turned on
+void init_save(void);
+
+// returns 1 if the log ends with a game which hadn't finished
+uint8_t save_game_available(void);
+
+// replay the unfinished game onto the board (which should have just been
+// set up with initialise_board()). Returns SAVE_RESUMED and
+// SAVE_RESUMED_TIMED flags, 0 if there was no game to resume
+uint8_t save_resume(void);
+
+// start saving a new game
+void save_new_game(void);
+
+// record a piece placed at (x, y). 'timed' is 1 during a timed game
+void save_move(uint8_t x, uint8_t y, uint8_t timed);
+
+#if BOARD_FITS_BITBOARD
+// record the board being replaced by 'position' with 'player' to move
+void save_position(const Position* position, uint8_t player);
+#endif
+
+// record that the last move was taken back
+void save_undo(void);
+
+// record that the game has finished, so it won't be resumed
+void save_game_over(void);
+
+// write the board (or the end of the game) if records had to be left out
+// because the queue was full. Call regularly, e.g. from the main loop
+void save_update(void);
+
+#endif /* SAVE_H_ */
@@ -22,9 +22,14 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "serialio.h"
+#include "timer0.h"
 
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
@@ -46,15 +51,60 @@ volatile char out_buffer[OUTPUT_BUFFER_SIZE];
 volatile uint8_t out_insert_pos;
 volatile uint8_t bytes_in_out_buffer;
 
-/* Circular buffer to hold incoming characters. Works on same principle
- * as output buffer
+/* Set once the UART has been given a character. Until then the transmit
+ * complete flag (TXC0) is never set, see serial_set_baud_rate(). */
+static volatile uint8_t uart_has_sent;
+
+/* Circular buffer to hold incoming characters. The receive interrupt is
+ * the only writer of input_head and the reader (main program) the only
+ * writer of input_tail, so neither side needs to turn interrupts off.
+ * Both count up freely (wrapping at 256) and are masked to index the
+ * buffer, so INPUT_BUFFER_SIZE must be a power of two no larger than 128.
+ * input_head - input_tail is the number of characters waiting.
  */
-#define INPUT_BUFFER_SIZE 16
+#define INPUT_BUFFER_SIZE 64
+#define INPUT_BUFFER_MASK (INPUT_BUFFER_SIZE - 1)
 volatile char input_buffer[INPUT_BUFFER_SIZE];
-volatile uint8_t input_insert_pos;
-volatile uint8_t bytes_in_input_buffer;
+volatile uint8_t input_head;
+volatile uint8_t input_tail;
 volatile uint8_t input_overrun;
 
+/* Output policy of each stream, and the write held back for each
+ * SERIAL_POLICY_COALESCE stream (if its pending_length is not zero). A
+ * held back write only ever replaces an older one from the same stream.
+ */
+static uint8_t stream_policy[SERIAL_NUM_STREAMS];
+static char pending_write[SERIAL_NUM_STREAMS][SERIAL_COALESCE_SIZE];
+static uint8_t pending_length[SERIAL_NUM_STREAMS];
+static SerialStats stats;
+
+/* State of the binary frame decoder (see serialio.h for the frame format).
+ * frame_state is what the decoder expects the next byte to be.
+ */
+#define FRAME_WAIT_SYNC		0
+#define FRAME_WAIT_SEQUENCE	1
+#define FRAME_WAIT_LENGTH	2
+#define FRAME_WAIT_PAYLOAD	3
+#define FRAME_WAIT_CRC_LOW	4
+#define FRAME_WAIT_CRC_HIGH	5
+
+static uint8_t frame_state;
+static uint8_t frame_sequence;
+static uint8_t frame_length;
+static uint8_t frame_received;
+static uint16_t frame_crc;
+static uint8_t frame_payload[SERIAL_FRAME_MAX_PAYLOAD];
+
+/* Command line being collected by serial_line_receive(). Spaces are
+ * replaced by '\0' as they arrive so each token is a string of its own,
+ * starting at line_buffer[line_token_start[i]].
+ */
+static char line_buffer[SERIAL_LINE_MAX + 1];
+static uint8_t line_length;
+static uint8_t line_token_start[SERIAL_LINE_MAX_TOKENS];
+static uint8_t line_token_count;
+static uint8_t line_too_long;
+
 /* Variable to keep track of whether incoming characters are to be echoed
  * back or not.
  */
@@ -64,6 +114,8 @@ static int8_t do_echo;
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 static int uart_put_char(char, FILE*);
+static int buffer_put_char(char, uint8_t);
+static uint8_t buffer_put_available(const char*, uint8_t);
 static int uart_get_char(FILE*);
 
 /* Setup a stream that uses the uart get and put functions. We will
@@ -74,27 +126,40 @@ static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
 
 void init_serial_stdio(long baudrate, int8_t echo) {
 	uint16_t ubrr;
+	uint8_t double_speed;
 	/*
 	 * Initialise our buffers
 	*/
 	out_insert_pos = 0;
 	bytes_in_out_buffer = 0;
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
+	input_head = 0;
+	input_tail = 0;
 	input_overrun = 0;
+	line_length = 0;
+	line_token_count = 0;
+	frame_state = FRAME_WAIT_SYNC;
+	for(uint8_t i = 0; i < SERIAL_NUM_STREAMS; i++) {
+		stream_policy[i] = SERIAL_POLICY_BLOCK;
+		pending_length[i] = 0;
+	}
+	/* Only the latest score matters, so it never holds up the game */
+	stream_policy[SERIAL_STREAM_STATUS] = SERIAL_POLICY_COALESCE;
+	serial_reset_stats();
 	
 	/*
 	 * Record whether we're going to echo characters or not
 	*/
 	do_echo = echo;
 	
-	/* Configure the serial port baud rate */
-	/* (This differs from the datasheet formula so that we get 
-	 * rounding to the nearest integer while using integer division
-	 * (which truncates)).
-	*/
-	ubrr = ((SYSCLK / (8 * baudrate)) + 1)/2 - 1;
+	/* Configure the serial port baud rate, using double speed mode
+	 * if that gets closer to the requested rate */
+	(void)serial_baud_error(baudrate, &ubrr, &double_speed);
 	UBRR0 = ubrr;
+	if(double_speed) {
+		UCSR0A |= (1<<U2X0);
+	} else {
+		UCSR0A &= ~(1<<U2X0);
+	}
 	
 	/*
 	 * Enable transmission and receiving via UART. We don't enable
@@ -118,41 +183,175 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	stdin = &myStream;
 }
 
+/* Work out the UBRR value for a baud rate with the UART clock divided by
+ * 'divisor' (16 normally, 8 in double speed mode), and the error of the
+ * rate that gives in tenths of a percent.
+ */
+static int16_t ubrr_for_baud(long baudrate, uint8_t divisor, uint16_t* ubrr) {
+	/* (This differs from the datasheet formula so that we get 
+	 * rounding to the nearest integer while using integer division
+	 * (which truncates)).
+	*/
+	long value = ((SYSCLK / ((divisor / 2) * baudrate)) + 1)/2 - 1;
+	if(value < 0) {
+		value = 0;
+	} else if(value > 4095) {
+		value = 4095;
+	}
+	*ubrr = value;
+	long actual = SYSCLK / (divisor * (value + 1));
+	return ((actual - baudrate) * 1000) / baudrate;
+}
+
+int16_t serial_baud_error(long baudrate, uint16_t* ubrr, uint8_t* double_speed) {
+	uint16_t normal_ubrr, double_ubrr;
+	int16_t normal_error = ubrr_for_baud(baudrate, 16, &normal_ubrr);
+	int16_t double_error = ubrr_for_baud(baudrate, 8, &double_ubrr);
+	/* Normal speed samples each bit more times, so prefer it on a tie */
+	if(abs(normal_error) <= abs(double_error)) {
+		*ubrr = normal_ubrr;
+		*double_speed = 0;
+		return normal_error;
+	}
+	*ubrr = double_ubrr;
+	*double_speed = 1;
+	return double_error;
+}
+
+static const uint32_t standard_baud_rates[] PROGMEM = {
+	9600, 19200, 38400, 57600, 76800, 115200, 250000, 500000, 1000000
+};
+
+long serial_standard_baud_rate(uint8_t index) {
+	if(index >= sizeof(standard_baud_rates) / sizeof(standard_baud_rates[0])) {
+		return 0;
+	}
+	return pgm_read_dword(&standard_baud_rates[index]);
+}
+
+uint8_t serial_set_baud_rate(long baudrate) {
+	uint16_t ubrr;
+	uint8_t double_speed;
+	int16_t error = serial_baud_error(baudrate, &ubrr, &double_speed);
+	if(error > SERIAL_MAX_BAUD_ERROR || error < -SERIAL_MAX_BAUD_ERROR) {
+		return 0;
+	}
+	/* Let everything already queued go out at the old rate. Once the
+	 * buffer is empty there can still be one character in UDR0 and one
+	 * being shifted out (about 2ms at 9600 baud), so also wait for the
+	 * UART to say it has finished. TXC0 is cleared each time a character
+	 * is written to UDR0, so it is only set once the last one has gone.
+	 * (It is also clear if nothing has ever been sent.) */
+	while(bytes_in_out_buffer != 0) {
+		/* wait */
+	}
+	while(uart_has_sent && !(UCSR0A & (1<<TXC0))) {
+		/* wait */
+	}
+	UBRR0 = ubrr;
+	if(double_speed) {
+		UCSR0A |= (1<<U2X0);
+	} else {
+		UCSR0A &= ~(1<<U2X0);
+	}
+	return 1;
+}
+
+/* Busy loop used by the self test. Counts loop iterations until 'ms'
+ * milliseconds have passed or, if until_empty is set, the output buffer
+ * has emptied. The loop does the same work in both cases so the counts
+ * can be compared.
+ */
+static uint32_t self_test_spin(uint16_t ms, uint8_t until_empty) {
+	uint32_t count = 0;
+	uint32_t start = get_current_time();
+	while(get_current_time() - start < ms &&
+			(bytes_in_out_buffer != 0 || !until_empty)) {
+		count++;
+	}
+	return count;
+}
+
+void serial_self_test(SerialSelfTest* result) {
+	const char zeros[16] = {0};
+	while(bytes_in_out_buffer != 0) {
+		/* wait for anything already queued */
+	}
+
+	/* How fast the loop runs with the UART idle */
+	uint32_t idle_start = get_current_time();
+	uint32_t idle_count = self_test_spin(SERIAL_SELF_TEST_TIME, 0);
+	uint32_t idle_time = get_current_time() - idle_start;
+
+	/* Then keep the output buffer full of NUL characters (which terminals
+	 * ignore) for at least as long, counting how fast the loop runs
+	 * while the UART interrupt is taking its share of the CPU */
+	uint32_t busy_count = 0;
+	uint32_t bytes_sent = 0;
+	uint32_t busy_start = get_current_time();
+	while(get_current_time() - busy_start < SERIAL_SELF_TEST_TIME) {
+		uint8_t added;
+		do {
+			added = buffer_put_available(zeros, sizeof(zeros));
+			bytes_sent += added;
+		} while(added == sizeof(zeros));
+		busy_count += self_test_spin(SERIAL_SELF_TEST_TIME, 1);
+	}
+	bytes_sent -= bytes_in_out_buffer;
+	uint32_t busy_time = get_current_time() - busy_start;
+
+	/* The iterations we would have expected in busy_time, and the share
+	 * of them lost to the interrupt (in tenths of a percent) */
+	uint32_t expected = idle_count * busy_time / idle_time;
+	uint32_t lost_permille = 0;
+	if(expected > busy_count) {
+		lost_permille = (expected - busy_count) * 1000 / expected;
+	}
+	if(bytes_sent == 0 || busy_time == 0) {
+		bytes_sent = 1;
+		busy_time = 1;
+	}
+	result->bytes_per_second = bytes_sent * 1000 / busy_time;
+	result->isr_load_permille = lost_permille;
+	/* ns per byte = share of the time * time / bytes */
+	result->isr_ns_per_byte = lost_permille * busy_time * 1000 / bytes_sent;
+}
+
 int8_t serial_input_available(void) {
-	return (bytes_in_input_buffer != 0);
+	return (input_head != input_tail);
 }
 
 void clear_serial_input_buffer(void) {
-	/* Just adjust our buffer data so it looks empty */
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
+	/* Just adjust our buffer data so it looks empty. Only the tail is
+	 * changed, the interrupt owns the head */
+	input_tail = input_head;
 }
 
-static int uart_put_char(char c, FILE* stream) {
+uint8_t serial_output_space(void) {
+	return OUTPUT_BUFFER_SIZE - bytes_in_out_buffer;
+}
+
+static int buffer_put_char(char c, uint8_t policy) {
 	uint8_t interrupts_enabled;
 	
-	/* Add the character to the buffer for transmission (if there 
-	 * is space to do so). If not we wait until the buffer has space.
-	 * If the character is \n, we output \r (carriage return)
-	 * also.
-	*/
-	if(c == '\n') {
-		uart_put_char('\r', stream);
-	}
-	
 	/* If the buffer is full and interrupts are disabled then we
 	 * abort - we don't output the character since the buffer will
-	 * never be emptied if interrupts are disabled. If the buffer is full
-	 * and interrupts are enabled then we loop until the buffer has 
+	 * never be emptied if interrupts are disabled. The same goes if
+	 * the writing stream's policy says not to wait. Otherwise
+	 * if the buffer is full we loop until the buffer has 
 	 * enough space. The bytes_in_buffer variable will get modified by the
 	 * ISR which extracts bytes from the buffer.
 	*/
 	interrupts_enabled = bit_is_set(SREG, SREG_I);
-	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
-		if(!interrupts_enabled) {
+	if(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+		if(!interrupts_enabled || policy != SERIAL_POLICY_BLOCK) {
+			stats.dropped_bytes++;
 			return 1;
-		}		
-		/* else do nothing */
+		}
+		stats.stalls++;
+	}
+	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+		/* do nothing */
 	}
 	
 	/* Add the character to the buffer for transmission if there
@@ -181,38 +380,305 @@ static int uart_put_char(char c, FILE* stream) {
 	return 0;
 }
 
+void serial_put_char(char c) {
+	(void)buffer_put_char(c, stream_policy[SERIAL_STREAM_TERMINAL]);
+}
+
+/* Add as many bytes as will fit to the output buffer without waiting.
+ * Returns the number added.
+ */
+static uint8_t buffer_put_available(const char* data, uint8_t length) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint8_t count = OUTPUT_BUFFER_SIZE - bytes_in_out_buffer;
+	if(count > length) {
+		count = length;
+	}
+	for(uint8_t i = 0; i < count; i++) {
+		out_buffer[out_insert_pos++] = data[i];
+		if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
+			out_insert_pos = 0;
+		}
+	}
+	bytes_in_out_buffer += count;
+	if(count > 0) {
+		UCSR0B |= (1 << UDRIE0);
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+	return count;
+}
+
+void serial_set_policy(uint8_t stream, uint8_t policy) {
+	if(stream < SERIAL_NUM_STREAMS) {
+		stream_policy[stream] = policy;
+	}
+}
+
+/* serial_write() without sending held back writes first, so that writes
+ * which belong together (e.g. the parts of a frame) can't be split up by
+ * one from another stream
+ */
+static uint8_t stream_write(uint8_t stream, const char* data, uint8_t length) {
+	uint8_t policy = SERIAL_POLICY_BLOCK;
+	if(stream < SERIAL_NUM_STREAMS) {
+		policy = stream_policy[stream];
+	}
+	if(policy == SERIAL_POLICY_BLOCK) {
+		for(uint8_t i = 0; i < length; i++) {
+			if(buffer_put_char(data[i], policy)) {
+				return i;
+			}
+		}
+		return length;
+	}
+	if(policy == SERIAL_POLICY_COALESCE && length <= SERIAL_COALESCE_SIZE) {
+		if(pending_length[stream] == 0 && serial_output_space() >= length) {
+			return buffer_put_available(data, length);
+		}
+		/* Hold this write back (replacing any older one from this
+		 * stream) until there is room for all of it */
+		if(pending_length[stream] != 0) {
+			stats.coalesced_writes++;
+		}
+		for(uint8_t i = 0; i < length; i++) {
+			pending_write[stream][i] = data[i];
+		}
+		pending_length[stream] = length;
+		return length;
+	}
+	uint8_t count = buffer_put_available(data, length);
+	stats.dropped_bytes += length - count;
+	return count;
+}
+
+uint8_t serial_write(uint8_t stream, const char* data, uint8_t length) {
+	/* Anything held back goes first so output stays in order */
+	serial_flush_pending();
+	return stream_write(stream, data, length);
+}
+
+void serial_flush_pending(void) {
+	for(uint8_t stream = 0; stream < SERIAL_NUM_STREAMS; stream++) {
+		uint8_t length = pending_length[stream];
+		if(length != 0 && serial_output_space() >= length) {
+			(void)buffer_put_available(pending_write[stream], length);
+			pending_length[stream] = 0;
+		}
+	}
+}
+
+void serial_get_stats(SerialStats* stats_out) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	*stats_out = stats;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void serial_reset_stats(void) {
+	stats.stalls = 0;
+	stats.dropped_bytes = 0;
+	stats.coalesced_writes = 0;
+}
+
+static int uart_put_char(char c, FILE* stream) {
+	/* Add the character to the buffer for transmission (if there 
+	 * is space to do so). If not we wait until the buffer has space.
+	 * If the character is \n, we output \r (carriage return)
+	 * also.
+	*/
+	if(c == '\n') {
+		uart_put_char('\r', stream);
+	}
+	
+	return buffer_put_char(c, stream_policy[SERIAL_STREAM_TERMINAL]);
+}
+
+/* Remove the oldest character from the input buffer. There must be one.
+ */
+static char buffer_get_char(void) {
+	/*
+	 * The character is read before the tail is moved on, so the
+	 * interrupt can't overwrite it while we are reading it. No need to
+	 * turn interrupts off - the tail is a single byte which only we write.
+	 */
+	uint8_t tail = input_tail;
+	char c = input_buffer[tail & INPUT_BUFFER_MASK];
+	input_tail = tail + 1;
+	return c;
+}
+
 int uart_get_char(FILE* stream) {
 	/* Wait until we've received a character */
-	while(bytes_in_input_buffer == 0) {
+	while(input_head == input_tail) {
 		/* do nothing */
 	}
 	
-	/*
-	 * Turn interrupts off and remove a character from the input
-	 * buffer. We reenable interrupts if they were on.
-	 * The pending character is the one which is byte_in_input_buffer
-	 * characters before the insert position (taking into account
-	 * that we may need to wrap around).
+	char c = buffer_get_char();
+	/* If the character is a carriage return, turn it into a
+	 * linefeed. (This is done here rather than when the character
+	 * is received so that serial_read_byte() gets the raw bytes.)
 	 */
-	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
-	cli();
-	char c;
-	if(input_insert_pos - bytes_in_input_buffer < 0) {
-		/* Need to wrap around */
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer
-				+ INPUT_BUFFER_SIZE];
-	} else {
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
+	if (c == '\r') {
+		c = '\n';
 	}
-	
-	/* Decrement our count of bytes in the input buffer */
-	bytes_in_input_buffer--;
-	if(interrupts_enabled) {
-		sei();
-	}	
 	return c;
 }
 
+int16_t serial_read_byte(void) {
+	if(input_head == input_tail) {
+		return -1;
+	}
+	return (uint8_t)buffer_get_char();
+}
+
+uint8_t serial_input_overrun(void) {
+	uint8_t overrun = input_overrun;
+	input_overrun = 0;
+	return overrun;
+}
+
+uint8_t serial_line_receive(char c) {
+	if(c == '\r' || c == '\n') {
+		if(line_length == 0 && !line_too_long) {
+			/* Blank line, or the second half of a \r\n pair */
+			return SERIAL_LINE_INCOMPLETE;
+		}
+		uint8_t result = line_too_long ? SERIAL_LINE_TOO_LONG : SERIAL_LINE_READY;
+		line_buffer[line_length] = '\0';
+		line_length = 0;
+		line_too_long = 0;
+		return result;
+	}
+	if(line_length == 0) {
+		/* First character of a new line */
+		line_token_count = 0;
+	}
+	if(line_length >= SERIAL_LINE_MAX) {
+		line_too_long = 1;
+		return SERIAL_LINE_INCOMPLETE;
+	}
+	if(c == ' ' || c == '\t') {
+		c = '\0';
+	} else if(line_length == 0 || line_buffer[line_length - 1] == '\0') {
+		/* A new token starts here */
+		if(line_token_count < SERIAL_LINE_MAX_TOKENS) {
+			line_token_start[line_token_count++] = line_length;
+		} else {
+			line_too_long = 1;
+		}
+	}
+	line_buffer[line_length++] = c;
+	return SERIAL_LINE_INCOMPLETE;
+}
+
+uint8_t serial_line_token_count(void) {
+	return line_token_count;
+}
+
+const char* serial_line_token(uint8_t index) {
+	if(index >= line_token_count) {
+		return "";
+	}
+	return &line_buffer[line_token_start[index]];
+}
+
+uint16_t serial_crc16_update(uint16_t crc, uint8_t byte) {
+	/* CRC-16/CCITT, polynomial 0x1021, most significant bit first */
+	crc ^= (uint16_t)byte << 8;
+	for(uint8_t i = 0; i < 8; i++) {
+		if(crc & 0x8000) {
+			crc = (crc << 1) ^ 0x1021;
+		} else {
+			crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+uint8_t serial_frame_active(void) {
+	return frame_state != FRAME_WAIT_SYNC;
+}
+
+void serial_frame_reset(void) {
+	frame_state = FRAME_WAIT_SYNC;
+}
+
+uint8_t serial_frame_receive(uint8_t byte) {
+	switch(frame_state) {
+		case FRAME_WAIT_SYNC:
+			if(byte == SERIAL_FRAME_SYNC) {
+				frame_crc = SERIAL_CRC16_INIT;
+				frame_state = FRAME_WAIT_SEQUENCE;
+			}
+			return SERIAL_FRAME_INCOMPLETE;
+		case FRAME_WAIT_SEQUENCE:
+			frame_sequence = byte;
+			frame_crc = serial_crc16_update(frame_crc, byte);
+			frame_state = FRAME_WAIT_LENGTH;
+			return SERIAL_FRAME_INCOMPLETE;
+		case FRAME_WAIT_LENGTH:
+			if(byte > SERIAL_FRAME_MAX_PAYLOAD) {
+				frame_state = FRAME_WAIT_SYNC;
+				return SERIAL_FRAME_BAD;
+			}
+			frame_length = byte;
+			frame_received = 0;
+			frame_crc = serial_crc16_update(frame_crc, byte);
+			frame_state = (byte == 0) ? FRAME_WAIT_CRC_LOW : FRAME_WAIT_PAYLOAD;
+			return SERIAL_FRAME_INCOMPLETE;
+		case FRAME_WAIT_PAYLOAD:
+			frame_payload[frame_received++] = byte;
+			frame_crc = serial_crc16_update(frame_crc, byte);
+			if(frame_received == frame_length) {
+				frame_state = FRAME_WAIT_CRC_LOW;
+			}
+			return SERIAL_FRAME_INCOMPLETE;
+		case FRAME_WAIT_CRC_LOW:
+			if(byte != (uint8_t)frame_crc) {
+				frame_state = FRAME_WAIT_SYNC;
+				return SERIAL_FRAME_BAD;
+			}
+			frame_state = FRAME_WAIT_CRC_HIGH;
+			return SERIAL_FRAME_INCOMPLETE;
+		default:
+			frame_state = FRAME_WAIT_SYNC;
+			if(byte != (uint8_t)(frame_crc >> 8)) {
+				return SERIAL_FRAME_BAD;
+			}
+			return SERIAL_FRAME_READY;
+	}
+}
+
+uint8_t serial_frame_sequence(void) {
+	return frame_sequence;
+}
+
+const uint8_t* serial_frame_payload(uint8_t* length) {
+	*length = frame_length;
+	return frame_payload;
+}
+
+void serial_frame_send(uint8_t sequence, const uint8_t* payload, uint8_t length) {
+	char header[3] = { (char)SERIAL_FRAME_SYNC, (char)sequence, (char)length };
+	uint16_t crc = SERIAL_CRC16_INIT;
+	crc = serial_crc16_update(crc, sequence);
+	crc = serial_crc16_update(crc, length);
+	for(uint8_t i = 0; i < length; i++) {
+		crc = serial_crc16_update(crc, payload[i]);
+	}
+	char trailer[2] = { (char)crc, (char)(crc >> 8) };
+	/* A held back status line may go out before the frame, but not in
+	 * the middle of it */
+	serial_flush_pending();
+	(void)stream_write(SERIAL_STREAM_DATA, header, 3);
+	(void)stream_write(SERIAL_STREAM_DATA, (const char*)payload, length);
+	(void)stream_write(SERIAL_STREAM_DATA, trailer, 2);
+}
+
 /*
  * Define the interrupt handler for UART Data Register Empty (i.e. 
  * another character can be taken from our buffer and written out)
@@ -240,8 +706,14 @@ ISR(USART0_UDRE_vect)
 		 */
 		bytes_in_out_buffer--;
 		
-		/* Output the character via the UART */
+		/* Output the character via the UART, clearing the transmit
+		 * complete flag (by writing a 1 to it) so that it is only set
+		 * again once this character has gone - see
+		 * serial_set_baud_rate(). The error flags must be written as 0.
+		 */
+		UCSR0A = (UCSR0A & (1<<U2X0)) | (1<<TXC0);
 		UDR0 = c;
+		uart_has_sent = 1;
 	} else {
 		/* No data in the buffer. We disable the UART Data
 		 * Register Empty interrupt because otherwise it 
@@ -280,24 +752,16 @@ ISR(USART0_RX_vect)
 	 * overrun flag - it's up to the programmer to check/clear
 	 * this flag if desired.)
 	 */
-	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
+	uint8_t head = input_head;
+	if((uint8_t)(head - input_tail) >= INPUT_BUFFER_SIZE) {
 		input_overrun = 1;
 	} else {
-		/* If the character is a carriage return, turn it into a
-		 * linefeed 
-		*/
-		if (c == '\r') {
-			c = '\n';
-		}
-		
 		/* 
-		 * There is room in the input buffer 
+		 * There is room in the input buffer. The character is stored
+		 * before the head is moved on so the reader never sees a 
+		 * slot that hasn't been filled in yet.
 		 */
-		input_buffer[input_insert_pos++] = c;
-		bytes_in_input_buffer++;
-		if(input_insert_pos == INPUT_BUFFER_SIZE) {
-			/* Wrap around buffer pointer if necessary */
-			input_insert_pos = 0;
-		}
+		input_buffer[head & INPUT_BUFFER_MASK] = c;
+		input_head = head + 1;
 	}
 }
@@ -25,6 +25,42 @@
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 
+/* Baud rates. The UART clock is the 8MHz system clock divided by 16 (or by
+ * 8 in double speed (U2X) mode) and then by UBRR + 1, so only some rates
+ * can be made exactly. serial_baud_error() finds the closest setting for
+ * a rate and returns how far off it is in tenths of a percent (e.g. 21 is
+ * 2.1% fast). Rates further off than SERIAL_MAX_BAUD_ERROR are refused by
+ * serial_set_baud_rate().
+ */
+#define SERIAL_MAX_BAUD_ERROR 20
+int16_t serial_baud_error(long baudrate, uint16_t* ubrr, uint8_t* double_speed);
+
+/* The common baud rates, for building an error table. Returns 0 once
+ * index is past the end of the list.
+ */
+long serial_standard_baud_rate(uint8_t index);
+
+/* Change the baud rate once everything waiting to be sent has gone. 
+ * Returns 1 if the rate was changed, 0 if it can't be made accurately
+ * enough.
+ */
+uint8_t serial_set_baud_rate(long baudrate);
+
+/* Throughput self test. Sends NUL characters (which terminals ignore) as
+ * fast as the UART will take them for about 2 * SERIAL_SELF_TEST_TIME ms
+ * and reports the rate achieved and how much CPU time the transmit
+ * interrupt used. The interrupt time is worked out from how much slower a
+ * busy loop runs while sending than while idle.
+ */
+#define SERIAL_SELF_TEST_TIME 200
+typedef struct {
+	uint32_t bytes_per_second;
+	uint16_t isr_load_permille;		/* tenths of a percent of the CPU */
+	uint16_t isr_ns_per_byte;
+} SerialSelfTest;
+
+void serial_self_test(SerialSelfTest* result);
+
 /* Test if input is available from the serial port. Return 0 if not,
  * non-zero otherwise. If there is input available then it can be read
  * with a suitable standard IO library function, e.g. fgetc().
@@ -36,4 +72,135 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Return the number of characters that can currently be written to the
+ * serial port without blocking (i.e. the free space in the output buffer).
+ */
+uint8_t serial_output_space(void);
+
+/* Add a character to the serial output buffer directly, without going
+ * through the standard IO library. Waits for space the same way as output
+ * through stdout does. No '\r' is added before '\n'.
+ */
+void serial_put_char(char c);
+
+/* Output streams. Each stream has a policy that decides what happens when
+ * the output buffer doesn't have room for what is written to it. Standard
+ * output (printf etc.) and serial_put_char() use SERIAL_STREAM_TERMINAL,
+ * the score (see terminal_begin_status()) SERIAL_STREAM_STATUS and binary
+ * frames SERIAL_STREAM_DATA. init_serial_stdio() makes the status stream
+ * SERIAL_POLICY_COALESCE and the others SERIAL_POLICY_BLOCK.
+ */
+#define SERIAL_STREAM_TERMINAL	0
+#define SERIAL_STREAM_STATUS	1
+#define SERIAL_STREAM_DATA		2
+#define SERIAL_NUM_STREAMS		3
+
+/* Output policies.
+ * SERIAL_POLICY_BLOCK - wait until there is space (the default)
+ * SERIAL_POLICY_DROP - write what fits and discard the rest
+ * SERIAL_POLICY_COALESCE - a write which doesn't fit is held back and sent
+ *		whole once there is space. A newer write replaces one which is still
+ *		held back on the same stream, so only the latest status line is ever
+ *		sent. A held back write may go out after later writes to other
+ *		streams, so it should start by moving the terminal cursor. Writes
+ *		longer than SERIAL_COALESCE_SIZE are treated as SERIAL_POLICY_DROP
+ */
+#define SERIAL_POLICY_BLOCK		0
+#define SERIAL_POLICY_DROP		1
+#define SERIAL_POLICY_COALESCE	2
+#define SERIAL_COALESCE_SIZE	40
+
+void serial_set_policy(uint8_t stream, uint8_t policy);
+
+/* Write length bytes to the given stream. Returns the number of bytes
+ * accepted - this is less than length only if the stream's policy is
+ * SERIAL_POLICY_DROP (or a coalesced write was too long) and the buffer
+ * filled up. Only SERIAL_POLICY_BLOCK streams will ever wait.
+ */
+uint8_t serial_write(uint8_t stream, const char* data, uint8_t length);
+
+/* Send a held back SERIAL_POLICY_COALESCE write if there is now room for it.
+ * Call regularly (e.g. from the main loop).
+ */
+void serial_flush_pending(void);
+
+/* Counters for output which could not be sent straight away. stalls counts
+ * the times a blocking write had to wait for the buffer to empty,
+ * dropped_bytes the bytes discarded, and coalesced_writes the held back
+ * writes which were replaced by newer ones before they were sent.
+ */
+typedef struct {
+	uint16_t stalls;
+	uint16_t dropped_bytes;
+	uint16_t coalesced_writes;
+} SerialStats;
+
+void serial_get_stats(SerialStats* stats);
+void serial_reset_stats(void);
+
+/* Read a byte from the serial input without waiting and without the
+ * carriage return to linefeed translation that stdin does. Returns -1 if
+ * there is no input available.
+ */
+int16_t serial_read_byte(void);
+
+/* Returns 1 if input characters have been thrown away because the input
+ * buffer was full since the last call, and clears the flag.
+ */
+uint8_t serial_input_overrun(void);
+
+/* Command lines. Characters passed to serial_line_receive() are collected
+ * into a line and split into tokens at spaces as they arrive. When a line
+ * ending arrives SERIAL_LINE_READY is returned and the tokens can be read
+ * until the next character is passed in. Lines longer than SERIAL_LINE_MAX
+ * characters or with more than SERIAL_LINE_MAX_TOKENS tokens are reported
+ * as SERIAL_LINE_TOO_LONG. Blank lines are ignored.
+ */
+#define SERIAL_LINE_MAX			24
+#define SERIAL_LINE_MAX_TOKENS	4
+
+#define SERIAL_LINE_INCOMPLETE	0
+#define SERIAL_LINE_READY		1
+#define SERIAL_LINE_TOO_LONG	2
+
+uint8_t serial_line_receive(char c);
+uint8_t serial_line_token_count(void);
+const char* serial_line_token(uint8_t index);
+
+/* Binary frames, used by the remote control protocol (see remote.h).
+ * A frame is
+ *		SERIAL_FRAME_SYNC, sequence, length, payload[length], crc low, crc high
+ * where the CRC is serial_crc16_update() over the sequence number, length
+ * and payload starting from SERIAL_CRC16_INIT.
+ */
+#define SERIAL_FRAME_SYNC			0xA5
+#define SERIAL_FRAME_MAX_PAYLOAD	64
+#define SERIAL_CRC16_INIT			0xFFFF
+
+/* Values returned by serial_frame_receive() */
+#define SERIAL_FRAME_INCOMPLETE	0
+#define SERIAL_FRAME_READY		1
+#define SERIAL_FRAME_BAD		2
+
+uint16_t serial_crc16_update(uint16_t crc, uint8_t byte);
+
+/* Pass the next received byte to the frame decoder. Bytes before a
+ * SERIAL_FRAME_SYNC are ignored. Once SERIAL_FRAME_READY is returned the
+ * frame can be read with serial_frame_sequence() and serial_frame_payload()
+ * until the next byte is passed in.
+ */
+uint8_t serial_frame_receive(uint8_t byte);
+
+/* Returns 1 if the decoder is part way through a frame */
+uint8_t serial_frame_active(void);
+
+/* Abandon a partly received frame */
+void serial_frame_reset(void);
+
+uint8_t serial_frame_sequence(void);
+const uint8_t* serial_frame_payload(uint8_t* length);
+
+/* Send a frame on SERIAL_STREAM_DATA */
+void serial_frame_send(uint8_t sequence, const uint8_t* payload, uint8_t length);
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
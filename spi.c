@@ -7,6 +7,13 @@
 #include <avr/io.h>
 #include "spi.h"
 
+#ifndef F_CPU
+#define F_CPU 8000000L
+#endif
+#include <util/delay.h>
+
+static uint8_t byte_gap;
+
 void spi_setup_master(uint8_t clockdivider) {
 	// Set up SPI communication as a master
 	// Make the SS, MOSI and SCK pins outputs. These are pins
@@ -54,6 +61,10 @@ void spi_setup_master(uint8_t clockdivider) {
 	PORTB &= ~(1<<4);
 }
 
+void spi_set_byte_gap(uint8_t microseconds) {
+	byte_gap = microseconds;
+}
+
 uint8_t spi_send_byte(uint8_t byte) {
 	// Write out the byte to the SPDR0 register. This will initiate
 	// the transfer. We then wait until the most significant byte of
@@ -65,5 +76,8 @@ uint8_t spi_send_byte(uint8_t byte) {
 	while((SPSR0 & (1<<SPIF0)) == 0) {
 		; // wait
 	}
+	for(uint8_t i = 0; i < byte_gap; i++) {
+		_delay_us(1);
+	}
 	return SPDR0;
 }
\ No newline at end of file
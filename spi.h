@@ -11,6 +11,10 @@
 // clockdivider should be one of 2,4,8,16,32,64,128
 void spi_setup_master(uint8_t clockdivider);
 
+// Set the number of microseconds to wait after sending each byte, to give
+// a slow slave time to deal with it. The default is 0
+void spi_set_byte_gap(uint8_t microseconds);
+
 // Send and receive an SPI byte. This function will take at least 8 
 // cyles of the divided clock (i.e. will busy wait).
 uint8_t spi_send_byte(uint8_t byte);
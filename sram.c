@@ -0,0 +1,97 @@
+/*
+ * sram.c
+ *
+ * Stack painting and SRAM headroom measurement. See sram.h.
+ */
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "sram.h"
+#include "terminalio.h"
+
+// the byte unused stack is filled with. Unlikely to be a common value in
+// real stack frames (return addresses, zeros, small counters)
+#define STACK_PAINT 0xC5
+
+// symbols provided by the linker: the start of the static variables and
+// the end of them (which is where the heap would start - we don't use one)
+extern uint8_t __data_start;
+extern uint8_t _end;
+
+static uint16_t phase_free[SRAM_NUM_PHASES] = { 0xFFFF, 0xFFFF, 0xFFFF };
+
+// Paint from the end of the static variables to the top of RAM. This runs
+// in .init1, before the stack pointer is set up and before r1 is cleared,
+// so it has to be naked and written in assembler. The static variables
+// themselves are set up afterwards (in .init4) so aren't affected.
+void sram_paint_stack(void) __attribute__((naked, used, section(".init1")));
+void sram_paint_stack(void) {
+	__asm__ volatile (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(%1)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(%1)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_PAINT), "i" (RAMEND));
+}
+
+uint16_t sram_static_size(void) {
+	return &_end - &__data_start;
+}
+
+uint16_t sram_stack_free(void) {
+	const uint8_t* p = &_end;
+	while (p <= (const uint8_t*)RAMEND && *p == STACK_PAINT) {
+		p++;
+	}
+	return p - &_end;
+}
+
+void sram_end_phase(uint8_t phase) {
+	uint16_t free_bytes = sram_stack_free();
+	if (free_bytes < phase_free[phase]) {
+		phase_free[phase] = free_bytes;
+	}
+	// Repaint up to the stack pointer. Everything below it is unused (any
+	// interrupt handler that runs in the meantime has finished with its
+	// part of it before we carry on) so interrupts can stay on
+	uint8_t* p = &_end + free_bytes;
+	uint8_t* top = (uint8_t*)SP;
+	while (p < top) {
+		*p++ = STACK_PAINT;
+	}
+}
+
+uint16_t sram_phase_free(uint8_t phase) {
+	return phase_free[phase];
+}
+
+// print a phase's free stack, or "-" if it hasn't been measured
+static void print_phase(const char* name, uint8_t phase) {
+	terminal_print_P(name);
+	if (phase_free[phase] == 0xFFFF) {
+		terminal_print_P(PSTR("-"));
+	} else {
+		terminal_print_number(phase_free[phase], 0);
+	}
+}
+
+void sram_report(uint8_t y) {
+	move_terminal_cursor(10, y);
+	clear_to_end_of_line();
+	terminal_print_P(PSTR("SRAM: static "));
+	terminal_print_number(sram_static_size(), 0);
+	terminal_print_P(PSTR(", stack free now "));
+	terminal_print_number(sram_stack_free(), 0);
+	print_phase(PSTR(", start "), SRAM_PHASE_START_SCREEN);
+	print_phase(PSTR(", game "), SRAM_PHASE_GAME);
+	print_phase(PSTR(", game over "), SRAM_PHASE_GAME_OVER);
+}
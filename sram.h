@@ -0,0 +1,47 @@
+/*
+ * sram.h
+ *
+ * SRAM usage. At reset (before main() is called) all of the RAM between
+ * the end of the static variables and the top of the stack is filled with
+ * a known byte. Counting how much of it is still untouched later on gives
+ * the stack's deepest excursion since it was painted, and so how much RAM
+ * is really free.
+ *
+ * Each part of the program (start screen, game, game over screen) calls
+ * sram_end_phase() when it finishes, which records the headroom seen
+ * during that phase and then repaints the unused part of the stack so the
+ * next phase is measured on its own. The figures include any interrupt
+ * handlers which ran during the phase.
+ *
+ * host/sram_report.sh gives the matching build time figures (the .data
+ * and .bss of each module).
+ */
+
+#ifndef SRAM_H_
+#define SRAM_H_
+
+#include <stdint.h>
+
+#define SRAM_PHASE_START_SCREEN	0
+#define SRAM_PHASE_GAME			1
+#define SRAM_PHASE_GAME_OVER	2
+#define SRAM_NUM_PHASES			3
+
+// bytes used by static variables (.data and .bss)
+uint16_t sram_static_size(void);
+
+// bytes between the static variables and the deepest point the stack has
+// reached since it was last painted
+uint16_t sram_stack_free(void);
+
+// record the least free stack seen during 'phase' and repaint the stack
+void sram_end_phase(uint8_t phase);
+
+// the least free stack seen during any run of 'phase', or 0xFFFF if that
+// phase hasn't finished yet
+uint16_t sram_phase_free(uint8_t phase);
+
+// print the static size and each phase's free stack on terminal row y
+void sram_report(uint8_t y);
+
+#endif /* SRAM_H_ */
@@ -0,0 +1,176 @@
+/*
+ * stability.c
+ *
+ * Stable and frontier discs. See stability.h.
+ */
+
+#include <stdint.h>
+
+#include "stability.h"
+#include "display.h"
+
+#if BOARD_FITS_BITBOARD
+
+// one line of each kind, the others are these moved across the board
+#define ROW_0			0x00000000000000FFULL	// y == 0
+#define COLUMN_0		0x0101010101010101ULL	// x == 0
+#define DIAGONAL		0x8040201008040201ULL	// x == y
+#define ANTI_DIAGONAL	0x0102040810204080ULL	// x + y == 7
+
+static BitBoard full_lines[STABILITY_NUM_AXES];
+static BitBoard stable_p1;
+static BitBoard stable_p2;
+static Position current;
+
+// every square on the line along 'axis' through (x, y). The lines are
+// moved a row (a byte) at a time, as 64 bit shifts by a variable amount
+// are slow on the AVR
+static BitBoard line_through(uint8_t x, uint8_t y, uint8_t axis) {
+	BitBoard line;
+	uint8_t i;
+	switch (axis) {
+		case STABILITY_ROW:
+			line = ROW_0;
+			for (i = 0; i < y; i++) {
+				line <<= 8;
+			}
+			break;
+		case STABILITY_COLUMN:
+			line = COLUMN_0;
+			for (i = 0; i < x; i++) {
+				line <<= 1;
+			}
+			break;
+		case STABILITY_DIAGONAL:
+			// the diagonal x - y == 0 moved up or down to (x, y)
+			line = DIAGONAL;
+			for (i = x; i < y; i++) {
+				line <<= 8;
+			}
+			for (i = y; i < x; i++) {
+				line >>= 8;
+			}
+			break;
+		default:
+			// the anti-diagonal x + y == 7 moved up or down to (x, y)
+			line = ANTI_DIAGONAL;
+			for (i = 7; i < x + y; i++) {
+				line <<= 8;
+			}
+			for (i = x + y; i < 7; i++) {
+				line >>= 8;
+			}
+	}
+	return line & BITBOARD_ON_BOARD;
+}
+
+// squares with no square beyond them on one side or the other along 'axis'
+static BitBoard axis_edge(uint8_t axis) {
+	return BITBOARD_ON_BOARD & ~(bitboard_shift(BITBOARD_ON_BOARD, axis) &
+			bitboard_shift(BITBOARD_ON_BOARD, axis + 4));
+}
+
+// squares whose line along 'axis' has no empty square on it
+static BitBoard find_full_lines(BitBoard occupied, uint8_t axis) {
+	BitBoard full = 0;
+	// every line along the axis crosses the bottom row or the column at
+	// the left (the right for anti-diagonals). Rows and columns are
+	// found more than once, which doesn't matter
+	uint8_t side_x = (axis == STABILITY_ANTI_DIAGONAL) ? BOARD_WIDTH - 1 : 0;
+	for (uint8_t i = 0; i < BOARD_WIDTH + BOARD_HEIGHT - 1; i++) {
+		BitBoard line = (i < BOARD_WIDTH) ?
+				line_through(i, 0, axis) :
+				line_through(side_x, i - BOARD_WIDTH + 1, axis);
+		if ((line & ~occupied) == 0) {
+			full |= line;
+		}
+	}
+	return full;
+}
+
+// adds to 'stable' (which must only hold discs from 'discs') every disc
+// of 'discs' which passes the test in stability.h, until no more do
+static BitBoard grow_stable(BitBoard discs, BitBoard stable, const BitBoard* full) {
+	BitBoard safe[STABILITY_NUM_AXES];
+	for (uint8_t axis = 0; axis < STABILITY_NUM_AXES; axis++) {
+		safe[axis] = full[axis] | axis_edge(axis);
+	}
+	while (1) {
+		BitBoard found = discs & ~stable;
+		for (uint8_t axis = 0; axis < STABILITY_NUM_AXES && found; axis++) {
+			found &= safe[axis] | bitboard_shift(stable, axis) |
+					bitboard_shift(stable, axis + 4);
+		}
+		if (found == 0) {
+			return stable;
+		}
+		stable |= found;
+	}
+}
+
+// grows both players' stable discs for the current position. A stable
+// disc is never flipped, the masks only matter if a caller gets that wrong
+static void update_stable(void) {
+	stable_p1 = grow_stable(current.p1, stable_p1 & current.p1, full_lines);
+	stable_p2 = grow_stable(current.p2, stable_p2 & current.p2, full_lines);
+}
+
+void stability_reset(const Position* position) {
+	current = *position;
+	BitBoard occupied = position->p1 | position->p2;
+	for (uint8_t axis = 0; axis < STABILITY_NUM_AXES; axis++) {
+		full_lines[axis] = find_full_lines(occupied, axis);
+	}
+	stable_p1 = 0;
+	stable_p2 = 0;
+	update_stable();
+}
+
+void stability_move(const Position* position, uint8_t square) {
+	current = *position;
+	// only the lines through the new disc can have filled up
+	BitBoard occupied = position->p1 | position->p2;
+	uint8_t x = BITBOARD_SQUARE_X(square);
+	uint8_t y = BITBOARD_SQUARE_Y(square);
+	for (uint8_t axis = 0; axis < STABILITY_NUM_AXES; axis++) {
+		BitBoard line = line_through(x, y, axis);
+		if ((line & ~occupied) == 0) {
+			full_lines[axis] |= line;
+		}
+	}
+	update_stable();
+}
+
+BitBoard stability_stable(uint8_t player) {
+	return (player == PLAYER_1) ? stable_p1 : stable_p2;
+}
+
+BitBoard stability_frontier(uint8_t player) {
+	if (player == PLAYER_1) {
+		return stability_find_frontier(current.p1, current.p2);
+	}
+	return stability_find_frontier(current.p2, current.p1);
+}
+
+BitBoard stability_full_lines(uint8_t axis) {
+	return full_lines[axis];
+}
+
+BitBoard stability_find_stable(BitBoard own, BitBoard opp) {
+	BitBoard full[STABILITY_NUM_AXES];
+	for (uint8_t axis = 0; axis < STABILITY_NUM_AXES; axis++) {
+		full[axis] = find_full_lines(own | opp, axis);
+	}
+	return grow_stable(own, 0, full);
+}
+
+BitBoard stability_find_frontier(BitBoard own, BitBoard opp) {
+	BitBoard empty = ~(own | opp) & BITBOARD_ON_BOARD;
+	BitBoard next_to_empty = 0;
+	for (uint8_t d = 0; d < BITBOARD_NUM_DIRECTIONS; d++) {
+		next_to_empty |= bitboard_shift(empty, d);
+	}
+	return own & next_to_empty;
+}
+
+#endif /* BOARD_FITS_BITBOARD */
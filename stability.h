@@ -0,0 +1,75 @@
+/*
+ * stability.h
+ *
+ * Stable discs and frontier discs, as bitboards.
+ *
+ * A stable disc can never be flipped, whatever is played. A disc can only
+ * be flipped along one of the four lines through it (the row, the column
+ * and the two diagonals), so it is stable if along every one of them it
+ * is either
+ *		- on the edge of the board (there is no square beyond it on one side),
+ *		- on a full line (there is nowhere left to play on it), or
+ *		- next to a stable disc of its own colour.
+ * Starting from the corners, which are always stable, stable discs are
+ * found by repeatedly adding the discs which pass this test. (Some discs
+ * which can never be flipped don't pass it, but every disc which passes
+ * it really is stable.)
+ *
+ * A frontier disc is one next to an empty square. Frontier discs are the
+ * ones the opponent can play against, so having few is good.
+ *
+ * The state kept here can follow a game: stability_reset() works
+ * everything out for a position, and after each move stability_move()
+ * brings it up to date (host/stability_bench.c checks this against working
+ * it out from nothing). The firmware itself doesn't keep it, as nothing on
+ * the board reads it; the search uses the functions which take any
+ * position. Stable discs stay stable and full lines stay full
+ * as the game goes on, so the update only has to look at the lines
+ * through the new disc and grow the stable discs found already. Taking a
+ * move back needs stability_reset().
+ *
+ * Only boards which fit in a bitboard (see board.h) are covered.
+ */
+
+#ifndef STABILITY_H_
+#define STABILITY_H_
+
+#include <stdint.h>
+
+#include "board.h"
+#include "bitboard.h"
+#include "position.h"
+
+#if BOARD_FITS_BITBOARD
+
+// the lines through a square. Axis a runs in bitboard directions a and
+// a + 4 (see bitboard.h)
+#define STABILITY_ROW		0
+#define STABILITY_DIAGONAL	1	// +x +y
+#define STABILITY_COLUMN	2
+#define STABILITY_ANTI_DIAGONAL	3	// -x +y
+#define STABILITY_NUM_AXES	4
+
+// works out the stable discs and full lines of 'position' from nothing
+void stability_reset(const Position* position);
+
+// brings everything up to date after a disc has been placed on 'square'
+// (a bitboard square index). 'position' is the position after the move
+void stability_move(const Position* position, uint8_t square);
+
+// the stable discs and the frontier discs of 'player' in the position
+// last given to stability_reset() or stability_move()
+BitBoard stability_stable(uint8_t player);
+BitBoard stability_frontier(uint8_t player);
+
+// squares whose line along 'axis' is full
+BitBoard stability_full_lines(uint8_t axis);
+
+// the same worked out for any position (e.g. in a search), without
+// touching the state above
+BitBoard stability_find_stable(BitBoard own, BitBoard opp);
+BitBoard stability_find_frontier(BitBoard own, BitBoard opp);
+
+#endif /* BOARD_FITS_BITBOARD */
+
+#endif /* STABILITY_H_ */
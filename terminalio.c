@@ -2,6 +2,11 @@
  * terminalio.c
  *
  * Author: Peter Sutton
+ *
+ * Escape sequences and numbers are written straight into the serial output
+ * buffer rather than through printf_P(), which has to parse its format
+ * string and goes through the stdio stream for every character. Constant
+ * strings stay in program memory.
  */
 
 #include <stdio.h>
@@ -10,53 +15,130 @@
 #include <avr/pgmspace.h>
 
 #include "terminalio.h"
+#include "serialio.h"
+
+/* Powers of ten used to find the digits of a number by repeated
+ * subtraction, which is much cheaper than division on the AVR */
+static const uint16_t powers_of_ten[] PROGMEM = {10000, 1000, 100, 10, 1};
+#define MAX_DIGITS 5
+
+/* Output between terminal_begin_status() and terminal_end_status() is
+ * collected here rather than going into the serial output buffer */
+static char status_line[SERIAL_COALESCE_SIZE];
+static uint8_t status_length;
+static uint8_t collecting_status;
+
+static void put_char(char c) {
+	if(!collecting_status) {
+		serial_put_char(c);
+	} else if(status_length < SERIAL_COALESCE_SIZE) {
+		status_line[status_length++] = c;
+	}
+}
+
+void terminal_begin_status(void) {
+	status_length = 0;
+	collecting_status = 1;
+}
+
+void terminal_end_status(void) {
+	collecting_status = 0;
+	(void)serial_write(SERIAL_STREAM_STATUS, status_line, status_length);
+}
+
+void terminal_print_P(const char* string) {
+	char c;
+	while((c = pgm_read_byte(string++)) != '\0') {
+		put_char(c);
+	}
+}
+
+void terminal_print_number(uint16_t value, uint8_t width) {
+	char digits[MAX_DIGITS];
+	uint8_t num_digits = 0;
+	for(uint8_t i = 0; i < MAX_DIGITS; i++) {
+		uint16_t power = pgm_read_word(&powers_of_ten[i]);
+		char digit = '0';
+		while(value >= power) {
+			value -= power;
+			digit++;
+		}
+		/* Skip leading zeros, but always keep the last digit */
+		if(num_digits > 0 || digit != '0' || i == MAX_DIGITS - 1) {
+			digits[num_digits++] = digit;
+		}
+	}
+	while(width > num_digits) {
+		put_char(' ');
+		width--;
+	}
+	for(uint8_t i = 0; i < num_digits; i++) {
+		put_char(digits[i]);
+	}
+}
+
+/* Send the start of a control sequence, ESC [ */
+static void put_csi(void) {
+	put_char('\x1b');
+	put_char('[');
+}
 
 void move_terminal_cursor(int x, int y) {
-    printf_P(PSTR("\x1b[%d;%dH"), y, x);
+	put_csi();
+	terminal_print_number(y, 0);
+	put_char(';');
+	terminal_print_number(x, 0);
+	put_char('H');
 }
 
 void normal_display_mode(void) {
-	printf_P(PSTR("\x1b[0m"));
+	terminal_print_P(PSTR("\x1b[0m"));
 }
 
 void reverse_video(void) {
-	printf_P(PSTR("\x1b[7m"));
+	terminal_print_P(PSTR("\x1b[7m"));
 }
 
 void clear_terminal(void) {
-	printf_P(PSTR("\x1b[2J"));
+	terminal_print_P(PSTR("\x1b[2J"));
 }
 
 void clear_to_end_of_line(void) {
-	printf_P(PSTR("\x1b[K"));
+	terminal_print_P(PSTR("\x1b[K"));
 }
 
 void set_display_attribute(DisplayParameter parameter) {
-	printf_P(PSTR("\x1b[%dm"), parameter);
+	put_csi();
+	terminal_print_number(parameter, 0);
+	put_char('m');
 }
 
 void hide_cursor() {
-	printf_P(PSTR("\x1b[?25l"));
+	terminal_print_P(PSTR("\x1b[?25l"));
 }
 
 void show_cursor() {
-	printf_P(PSTR("\x1b[?25h"));
+	terminal_print_P(PSTR("\x1b[?25h"));
 }
 
 void enable_scrolling_for_whole_display(void) {
-	printf_P(PSTR("\x1b[r"));
+	terminal_print_P(PSTR("\x1b[r"));
 }
 
 void set_scroll_region(int8_t y1, int8_t y2) {
-	printf_P(PSTR("\x1b[%d;%dr"), y1, y2);
+	put_csi();
+	terminal_print_number(y1, 0);
+	put_char(';');
+	terminal_print_number(y2, 0);
+	put_char('r');
 }
 
 void scroll_down(void) {
-	printf_P(PSTR("\x1bM"));	// ESC-M
+	terminal_print_P(PSTR("\x1bM"));	// ESC-M
 }
 
 void scroll_up(void) {
-	printf_P(PSTR("\x1b\x44"));	// ESC-D
+	terminal_print_P(PSTR("\x1b\x44"));	// ESC-D
 }
 
 void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
@@ -64,10 +146,7 @@ void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
 	move_terminal_cursor(start_x, y);
 	reverse_video();
 	for(i=start_x; i <= end_x; i++) {
-		printf(" ");	/* No need to use printf_P - printing 
-						 * a single character gets optimised
-						 * to a putchar call 
-						 */
+		put_char(' ');
 	}
 	normal_display_mode();
 }
@@ -77,10 +156,94 @@ void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y) {
 	move_terminal_cursor(x, start_y);
 	reverse_video();
 	for(i=start_y; i < end_y; i++) {
-		printf(" ");
+		put_char(' ');
 		/* Move down one and back to the left one */
-		printf_P(PSTR("\x1b[B\x1b[D"));
+		terminal_print_P(PSTR("\x1b[B\x1b[D"));
 	}
-	printf(" ");
+	put_char(' ');
 	normal_display_mode();
 }
+
+/* Board view state. board_cells holds what each cell is showing, or is about
+ * to show if its bit in dirty_rows is set.
+ */
+#define TERM_CELL_EMPTY TERM_CELL('.', FG_WHITE)
+#define NO_COLOUR 0xFF
+/* The most that sending one cell can take: a cursor move, a colour change
+ * and the character itself */
+#define TERM_CELL_MAX_BYTES 16
+
+/* One bit per cell in each row */
+#if TERM_BOARD_WIDTH > 8
+typedef uint16_t RowMask;
+#else
+typedef uint8_t RowMask;
+#endif
+
+static uint8_t board_cells[TERM_BOARD_HEIGHT][TERM_BOARD_WIDTH];
+static RowMask dirty_rows[TERM_BOARD_HEIGHT];
+static int8_t board_left, board_top;
+
+void init_terminal_board(int8_t x, int8_t y) {
+	board_left = x;
+	board_top = y;
+	for(uint8_t row = 0; row < TERM_BOARD_HEIGHT; row++) {
+		for(uint8_t col = 0; col < TERM_BOARD_WIDTH; col++) {
+			board_cells[row][col] = TERM_CELL_EMPTY;
+		}
+		dirty_rows[row] = (RowMask)~0;
+	}
+}
+
+void set_terminal_board_cell(uint8_t x, uint8_t y, uint8_t cell) {
+	if(x >= TERM_BOARD_WIDTH || y >= TERM_BOARD_HEIGHT) {
+		return;
+	}
+	if(board_cells[y][x] != cell) {
+		board_cells[y][x] = cell;
+		dirty_rows[y] |= ((RowMask)1 << x);
+	}
+}
+
+uint8_t update_terminal_board(void) {
+	uint8_t colour = NO_COLOUR;
+	uint8_t done = 1;
+	for(uint8_t y = 0; y < TERM_BOARD_HEIGHT && done; y++) {
+		/* Column (cell number) the terminal cursor is sitting just after,
+		 * or -1 if it is somewhere else */
+		int8_t after_x = -1;
+		for(uint8_t x = 0; x < TERM_BOARD_WIDTH; x++) {
+			if(!(dirty_rows[y] & ((RowMask)1 << x))) {
+				continue;
+			}
+			if(serial_output_space() < TERM_CELL_MAX_BYTES) {
+				/* Leave the rest until next time rather than block */
+				done = 0;
+				break;
+			}
+			uint8_t cell = board_cells[y][x];
+			if(after_x >= 0 && x == after_x + 1) {
+				/* Stepping over the gap between cells is shorter than
+				 * a cursor move */
+				put_char(' ');
+			} else {
+				/* Cells are two terminal columns apart, and row 0 is
+				 * at the bottom */
+				move_terminal_cursor(board_left + 2 * x,
+						board_top + (TERM_BOARD_HEIGHT - 1 - y));
+			}
+			if((cell >> 5) != colour) {
+				colour = cell >> 5;
+				set_display_attribute(FG_BLACK + colour);
+			}
+			put_char(' ' + (cell & 0x1F));
+			dirty_rows[y] &= ~((RowMask)1 << x);
+			after_x = x;
+		}
+	}
+	if(colour != NO_COLOUR) {
+		/* Put the colour back for anything else written to the terminal */
+		normal_display_mode();
+	}
+	return done;
+}
@@ -11,6 +11,8 @@
 #define TERMINAL_IO_H_
 
 #include <stdint.h>
+
+#include "board.h"
 /*
  * x (column number) and y (row number) are measured relative to the top
  * left of the screen. First column is 1, first row is 1.
@@ -54,6 +56,21 @@ typedef enum {
 	BG_WHITE = 47
 } DisplayParameter;
 
+// Write a string stored in program memory (e.g. PSTR("...")) to the terminal
+void terminal_print_P(const char* string);
+
+// Write a number right aligned in a field 'width' characters wide (a width
+// of 0 means no padding). This is a cheap replacement for printf("%10d")
+void terminal_print_number(uint16_t value, uint8_t width);
+
+// Status lines. Output of the functions here between terminal_begin_status()
+// and terminal_end_status() is sent as one write to SERIAL_STREAM_STATUS,
+// so it never waits for the serial output buffer - if there is no room the
+// newest status is sent once there is. It must start with a cursor move and
+// fit in SERIAL_COALESCE_SIZE bytes (anything more is cut off)
+void terminal_begin_status(void);
+void terminal_end_status(void);
+
 void move_terminal_cursor(int x, int y);
 void normal_display_mode(void);
 void reverse_video(void);
@@ -86,4 +103,26 @@ void scroll_up(void);
 void draw_horizontal_line(int8_t y, int8_t startx, int8_t endx);
 void draw_vertical_line(int8_t x, int8_t starty, int8_t endy);
 
+// Board view. A grid of cells the size of the board (see board.h) is drawn
+// on the terminal with its top left cell at (x, y), and a copy of what is
+// on screen is kept so that only cells which change are sent. Cell (0, 0)
+// is the bottom left of the grid. Each cell is a character between ' ' and
+// '?' in a foreground colour, packed into a byte with TERM_CELL().
+#define TERM_BOARD_WIDTH BOARD_WIDTH
+#define TERM_BOARD_HEIGHT BOARD_HEIGHT
+#define TERM_CELL(c, fg) ((uint8_t)((((fg) - FG_BLACK) << 5) | (((c) - ' ') & 0x1F)))
+
+// Forget what is on screen and mark every cell as needing to be drawn.
+// All cells start as '.' in white
+void init_terminal_board(int8_t x, int8_t y);
+
+// Change what cell (x, y) should show. Nothing is sent until
+// update_terminal_board() is called
+void set_terminal_board_cell(uint8_t x, uint8_t y, uint8_t cell);
+
+// Send the cells which have changed, stopping early rather than waiting if
+// the serial output buffer is getting full. Returns 1 if the screen is up
+// to date, 0 if there are still cells waiting to be sent. Call regularly
+uint8_t update_terminal_board(void);
+
 #endif /* TERMINAL_IO_H */
\ No newline at end of file
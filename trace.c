@@ -0,0 +1,67 @@
+/*
+ * trace.c
+ *
+ * Event trace ring buffer. See trace.h.
+ */
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "trace.h"
+#include "timer0.h"
+
+#ifdef TRACE
+
+#define TRACE_MASK (TRACE_SIZE - 1)
+
+static TraceRecord ring[TRACE_SIZE];
+// head and tail count up freely and are masked to index the ring. When the
+// ring is full the oldest event is overwritten
+static uint8_t trace_head;
+static uint8_t trace_tail;
+
+// the time in 8us units: timer 0 counts 0 to 124 every millisecond
+static uint32_t trace_time(void) {
+	uint32_t ms = get_current_time();
+	uint8_t count = TCNT0;
+	// a compare match which hasn't been counted yet by the interrupt
+	// handler (because interrupts are off) means another millisecond
+	if ((TIFR0 & (1<<OCF0A)) && count < 64) {
+		ms++;
+	}
+	return ms * 125 + count;
+}
+
+void trace_log(uint8_t type, uint8_t arg) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	TraceRecord* record = &ring[trace_head & TRACE_MASK];
+	record->time = trace_time();
+	record->type = type;
+	record->arg = arg;
+	trace_head++;
+	if ((uint8_t)(trace_head - trace_tail) > TRACE_SIZE) {
+		trace_tail++;
+	}
+	if (interrupts_on) {
+		sei();
+	}
+}
+
+uint8_t trace_read(TraceRecord* records, uint8_t max) {
+	uint8_t count = 0;
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	while (count < max && trace_tail != trace_head) {
+		records[count++] = ring[trace_tail & TRACE_MASK];
+		trace_tail++;
+	}
+	if (interrupts_on) {
+		sei();
+	}
+	return count;
+}
+
+#endif /* TRACE */
@@ -0,0 +1,61 @@
+/*
+ * trace.h
+ *
+ * Event trace. Interrupt handlers and the main program log small
+ * timestamped records of what happened (button pushes, joystick samples,
+ * LED matrix updates, moves, ...) into a ring buffer in RAM, which always
+ * holds the most recent TRACE_SIZE events. The ring can be sent to a host
+ * with the REMOTE_TRACE_DUMP command (see remote.h) and turned into a
+ * timeline with host/trace_dump.
+ *
+ * Tracing is only compiled in when TRACE is defined (e.g. -DTRACE),
+ * otherwise TRACE_LOG() compiles to nothing.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+// number of events kept, must be a power of two
+#define TRACE_SIZE 32
+
+// event types, and what their argument byte holds
+#define TRACE_BUTTON		1	// button number
+#define TRACE_KEY			2	// character received
+#define TRACE_ADC_X			3	// joystick x sample / 4
+#define TRACE_ADC_Y			4	// joystick y sample / 4
+#define TRACE_SPI_FLUSH		5	// LED matrix command for a row/column/all update
+#define TRACE_LED_PIXEL		6	// (y << 4) | x of an LED matrix pixel update
+#define TRACE_MOVE			7	// (y << 4) | x of the square a piece was placed on
+#define TRACE_TURN_TICK		8	// seconds left in a timed turn
+
+// Each record is sent as 6 bytes: time (4 bytes, least significant byte
+// first) in units of TRACE_TICK_NS, type, argument
+#define TRACE_RECORD_BYTES	6
+#define TRACE_TICK_NS		8000
+
+#ifdef TRACE
+
+typedef struct {
+	uint32_t time;
+	uint8_t type;
+	uint8_t arg;
+} TraceRecord;
+
+// add an event to the ring. Safe to call from interrupt handlers
+void trace_log(uint8_t type, uint8_t arg);
+
+// copy out up to 'max' of the oldest events still waiting to be read,
+// removing them from the ring. Returns the number copied
+uint8_t trace_read(TraceRecord* records, uint8_t max);
+
+#define TRACE_LOG(type, arg) trace_log(type, arg)
+
+#else
+
+#define TRACE_LOG(type, arg)
+
+#endif /* TRACE */
+
+#endif /* TRACE_H_ */